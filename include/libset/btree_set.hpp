@@ -0,0 +1,826 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <libset/treeset.hpp>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace treeset {
+
+    namespace detail {
+
+        // Ключи узла лежат подряд; сконструированы первые count из них.
+        template <typename T, std::size_t Slots>
+        struct BTreeNode {
+            BTreeNode* parent;
+            std::uint16_t position;
+            std::uint16_t count;
+            bool leaf;
+            alignas(T) unsigned char storage[Slots * sizeof(T)];
+
+            T* keys() {
+                return std::launder(reinterpret_cast<T*>(storage));
+            }
+
+            const T* keys() const {
+                return std::launder(reinterpret_cast<const T*>(storage));
+            }
+        };
+
+        template <typename T, std::size_t Slots>
+        struct BTreeInternal : BTreeNode<T, Slots> {
+            BTreeNode<T, Slots>* children[Slots + 1];
+        };
+    }  // namespace detail
+
+    // B-дерево с тем же интерфейсом поиска, что у Set. Лист занимает
+    // около node_bytes байт, поэтому поиск делает O(log_B n) промахов
+    // кэша вместо O(log n), а накладные расходы на ключ — доли указателя.
+    //
+    // В отличие от Set ключи переезжают между узлами: insert и erase
+    // делают недействительными все итераторы.
+    template <
+        typename T,
+        typename Compare = std::less<>,
+        typename Allocator = std::allocator<T>>
+    class BTreeSet {
+       private:
+        static constexpr std::size_t node_bytes = 256;
+        static constexpr std::size_t header_bytes = 16;
+        static constexpr std::size_t slots = std::max<std::size_t>(
+            3, (node_bytes - header_bytes) / sizeof(T));
+        static constexpr std::size_t min_keys = (slots - 1) / 2;
+
+        using Node = detail::BTreeNode<T, slots>;
+        using Internal = detail::BTreeInternal<T, slots>;
+        using alloc_traits = std::allocator_traits<Allocator>;
+        using leaf_allocator =
+            typename alloc_traits::template rebind_alloc<Node>;
+        using internal_allocator =
+            typename alloc_traits::template rebind_alloc<Internal>;
+
+        Node* root_;
+        std::size_t size_;
+        [[no_unique_address]] Compare comp_;
+        [[no_unique_address]] Allocator alloc_;
+
+        static Node** children(Node* node) {
+            return static_cast<Internal*>(node)->children;
+        }
+
+        static Node* const* children(const Node* node) {
+            return static_cast<const Internal*>(node)->children;
+        }
+
+        Node* create_node(bool leaf) {
+            Node* node;
+            if (leaf) {
+                leaf_allocator alloc(alloc_);
+                node = std::allocator_traits<leaf_allocator>::allocate(
+                    alloc, 1);
+                ::new (static_cast<void*>(node)) Node;
+            } else {
+                internal_allocator alloc(alloc_);
+                node = std::allocator_traits<internal_allocator>::allocate(
+                    alloc, 1);
+                ::new (static_cast<void*>(node)) Internal;
+            }
+            node->parent = nullptr;
+            node->position = 0;
+            node->count = 0;
+            node->leaf = leaf;
+            return node;
+        }
+
+        // Ключи к этому моменту уже разрушены или перенесены.
+        void free_node(Node* node) {
+            if (node->leaf) {
+                leaf_allocator alloc(alloc_);
+                std::allocator_traits<leaf_allocator>::deallocate(
+                    alloc, node, 1);
+            } else {
+                internal_allocator alloc(alloc_);
+                std::allocator_traits<internal_allocator>::deallocate(
+                    alloc, static_cast<Internal*>(node), 1);
+            }
+        }
+
+        template <typename... Args>
+        void construct_key(T* slot, Args&&... args) {
+            alloc_traits::construct(alloc_, slot, std::forward<Args>(args)...);
+        }
+
+        void destroy_key(T* slot) {
+            alloc_traits::destroy(alloc_, slot);
+        }
+
+        void destroy_tree(Node* node) {
+            if (!node->leaf) {
+                for (std::size_t i = 0; i <= node->count; i++) {
+                    destroy_tree(children(node)[i]);
+                }
+            }
+            for (std::size_t i = 0; i < node->count; i++) {
+                destroy_key(node->keys() + i);
+            }
+            free_node(node);
+        }
+
+        // Копия поддерева в узлах своего аллокатора; при Move ключи
+        // переносятся из node, а не копируются.
+        template <bool Move = false>
+        Node* clone(
+            std::conditional_t<Move, Node*, const Node*> node,
+            Node* parent,
+            std::size_t position) {
+            auto copy = create_node(node->leaf);
+            copy->parent = parent;
+            copy->position = std::uint16_t(position);
+            for (std::size_t i = 0; i < node->count; i++) {
+                if constexpr (Move) {
+                    construct_key(
+                        copy->keys() + i, std::move(node->keys()[i]));
+                } else {
+                    construct_key(copy->keys() + i, node->keys()[i]);
+                }
+                copy->count = std::uint16_t(i + 1);
+            }
+            if (!node->leaf) {
+                for (std::size_t i = 0; i <= node->count; i++) {
+                    children(copy)[i] =
+                        clone<Move>(children(node)[i], copy, i);
+                }
+            }
+            return copy;
+        }
+
+        static void set_child(Node* node, std::size_t i, Node* child) {
+            children(node)[i] = child;
+            child->parent = node;
+            child->position = std::uint16_t(i);
+        }
+
+        // Первый ключ узла, не меньший key.
+        template <typename K>
+        std::size_t lower_index(const Node* node, const K& key) const {
+            std::size_t lo = 0;
+            std::size_t hi = node->count;
+            while (lo < hi) {
+                auto mid = (lo + hi) / 2;
+                if (comp_(node->keys()[mid], key)) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return lo;
+        }
+
+        // Первый ключ узла, больший key.
+        template <typename K>
+        std::size_t upper_index(const Node* node, const K& key) const {
+            std::size_t lo = 0;
+            std::size_t hi = node->count;
+            while (lo < hi) {
+                auto mid = (lo + hi) / 2;
+                if (comp_(key, node->keys()[mid])) {
+                    hi = mid;
+                } else {
+                    lo = mid + 1;
+                }
+            }
+            return lo;
+        }
+
+        // Ставит value на место i, сдвигая ключи [i, count) вправо;
+        // count не меняется.
+        void shift_key(Node* node, std::size_t i, T&& value) {
+            auto keys = node->keys();
+            std::size_t count = node->count;
+            if (i == count) {
+                construct_key(keys + i, std::move(value));
+                return;
+            }
+            construct_key(keys + count, std::move(keys[count - 1]));
+            std::move_backward(keys + i, keys + count - 1, keys + count);
+            keys[i] = std::move(value);
+        }
+
+        // Ставит child на место i, сдвигая детей [i, count] вправо.
+        static void shift_child(Node* node, std::size_t i, Node* child) {
+            for (auto j = std::size_t(node->count) + 1; j > i; j--) {
+                set_child(node, j, children(node)[j - 1]);
+            }
+            set_child(node, i, child);
+        }
+
+        // child становится правым ребенком нового ключа.
+        void insert_into(Node* node, std::size_t i, T&& value, Node* child) {
+            shift_key(node, i, std::move(value));
+            if (!node->leaf) {
+                shift_child(node, i + 1, child);
+            }
+            ++node->count;
+        }
+
+        void erase_from(Node* node, std::size_t i) {
+            auto keys = node->keys();
+            std::move(keys + i + 1, keys + node->count, keys + i);
+            destroy_key(keys + node->count - 1);
+            if (!node->leaf) {
+                for (auto j = i + 1; j < node->count; j++) {
+                    set_child(node, j, children(node)[j + 1]);
+                }
+            }
+            --node->count;
+        }
+
+        struct Position {
+            Node* node;
+            std::size_t index;
+        };
+
+        // Вставка в узел с расщеплением полных узлов снизу вверх.
+        // Возвращает, где в итоге оказался value.
+        Position insert_at(Node* node, std::size_t i, T&& value, Node* child) {
+            if (node->count < slots) {
+                insert_into(node, i, std::move(value), child);
+                return Position{node, i};
+            }
+
+            auto mid = slots / 2;
+            auto sibling = create_node(node->leaf);
+            auto keys = node->keys();
+            for (auto j = mid + 1; j < slots; j++) {
+                construct_key(
+                    sibling->keys() + (j - mid - 1), std::move(keys[j]));
+                destroy_key(keys + j);
+            }
+            if (!node->leaf) {
+                for (auto j = mid + 1; j <= slots; j++) {
+                    set_child(sibling, j - mid - 1, children(node)[j]);
+                }
+            }
+            sibling->count = std::uint16_t(slots - mid - 1);
+            T median(std::move(keys[mid]));
+            destroy_key(keys + mid);
+            node->count = std::uint16_t(mid);
+
+            Position result = i <= mid
+                ? insert_at(node, i, std::move(value), child)
+                : insert_at(sibling, i - mid - 1, std::move(value), child);
+
+            if (node == root_) {
+                root_ = create_node(false);
+                construct_key(root_->keys(), std::move(median));
+                root_->count = 1;
+                set_child(root_, 0, node);
+                set_child(root_, 1, sibling);
+            } else {
+                insert_at(
+                    node->parent, node->position, std::move(median), sibling);
+            }
+            return result;
+        }
+
+        // Переносит ключ из левого соседа через родителя.
+        void borrow_left(Node* parent, std::size_t pos) {
+            auto node = children(parent)[pos];
+            auto left = children(parent)[pos - 1];
+            shift_key(node, 0, std::move(parent->keys()[pos - 1]));
+            if (!node->leaf) {
+                shift_child(node, 0, children(left)[left->count]);
+            }
+            ++node->count;
+            parent->keys()[pos - 1] = std::move(left->keys()[left->count - 1]);
+            destroy_key(left->keys() + left->count - 1);
+            --left->count;
+        }
+
+        void borrow_right(Node* parent, std::size_t pos) {
+            auto node = children(parent)[pos];
+            auto right = children(parent)[pos + 1];
+            construct_key(
+                node->keys() + node->count, std::move(parent->keys()[pos]));
+            ++node->count;
+            parent->keys()[pos] = std::move(right->keys()[0]);
+            if (!right->leaf) {
+                set_child(node, node->count, children(right)[0]);
+                set_child(right, 0, children(right)[1]);
+            }
+            erase_from(right, 0);
+        }
+
+        // Сливает ребенка pos + 1 в ребенка pos вместе с разделителем.
+        void merge(Node* parent, std::size_t pos) {
+            auto left = children(parent)[pos];
+            auto right = children(parent)[pos + 1];
+            auto keys = left->keys();
+            construct_key(
+                keys + left->count, std::move(parent->keys()[pos]));
+            for (std::size_t j = 0; j < right->count; j++) {
+                construct_key(
+                    keys + left->count + 1 + j, std::move(right->keys()[j]));
+                destroy_key(right->keys() + j);
+            }
+            if (!left->leaf) {
+                for (std::size_t j = 0; j <= right->count; j++) {
+                    set_child(
+                        left, left->count + 1 + j, children(right)[j]);
+                }
+            }
+            left->count = std::uint16_t(left->count + 1 + right->count);
+            free_node(right);
+            // erase_from сдвигает детей после pos + 1, где был right
+            erase_from(parent, pos);
+        }
+
+        void rebalance(Node* node) {
+            while (node != root_ && node->count < min_keys) {
+                auto parent = node->parent;
+                std::size_t pos = node->position;
+                if (pos > 0 && children(parent)[pos - 1]->count > min_keys) {
+                    borrow_left(parent, pos);
+                    return;
+                }
+                if (pos < parent->count &&
+                    children(parent)[pos + 1]->count > min_keys) {
+                    borrow_right(parent, pos);
+                    return;
+                }
+                merge(parent, pos > 0 ? pos - 1 : pos);
+                node = parent;
+            }
+            if (root_->count == 0) {
+                auto old = root_;
+                if (root_->leaf) {
+                    root_ = nullptr;
+                } else {
+                    root_ = children(root_)[0];
+                    root_->parent = nullptr;
+                    root_->position = 0;
+                }
+                free_node(old);
+            }
+        }
+
+        // Ключ внутреннего узла заменяется предшественником из листа.
+        void erase_at(Node* node, std::size_t i) {
+            if (!node->leaf) {
+                auto leaf = children(node)[i];
+                while (!leaf->leaf) {
+                    leaf = children(leaf)[leaf->count];
+                }
+                node->keys()[i] = std::move(leaf->keys()[leaf->count - 1]);
+                node = leaf;
+                i = leaf->count - 1;
+            }
+            erase_from(node, i);
+            --size_;
+            rebalance(node);
+        }
+
+        template <typename K>
+        Position find_position(const K& key) const {
+            for (auto node = root_; node;) {
+                auto i = lower_index(node, key);
+                if (i < node->count && !comp_(key, node->keys()[i])) {
+                    return Position{node, i};
+                }
+                if (node->leaf) {
+                    break;
+                }
+                node = children(node)[i];
+            }
+            return Position{nullptr, 0};
+        }
+
+        template <typename K>
+        std::size_t erase_key(const K& key) {
+            auto pos = find_position(key);
+            if (!pos.node) {
+                return 0;
+            }
+            erase_at(pos.node, pos.index);
+            return 1;
+        }
+
+       public:
+        using key_type = T;
+        using value_type = T;
+        using key_compare = Compare;
+        using value_compare = Compare;
+        using allocator_type = Allocator;
+
+        class Iterator {
+           public:
+            using difference_type = std::ptrdiff_t;
+            using value_type = T;
+            using pointer = const T*;
+            using reference = const T&;
+            using iterator_category = std::bidirectional_iterator_tag;
+
+            Iterator() : node_(nullptr), index_(0) {
+            }
+
+            reference operator*() const {
+                return node_->keys()[index_];
+            }
+
+            pointer operator->() const {
+                return node_->keys() + index_;
+            }
+
+            Iterator& operator++() {
+                if (!node_->leaf) {
+                    node_ = children(node_)[index_ + 1];
+                    while (!node_->leaf) {
+                        node_ = children(node_)[0];
+                    }
+                    index_ = 0;
+                    return *this;
+                }
+                ++index_;
+                // конец — позиция за последним ключом корня
+                while (index_ == node_->count && node_->parent) {
+                    index_ = node_->position;
+                    node_ = node_->parent;
+                }
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            Iterator& operator--() {
+                if (!node_->leaf) {
+                    node_ = children(node_)[index_];
+                    while (!node_->leaf) {
+                        node_ = children(node_)[node_->count];
+                    }
+                    index_ = node_->count - 1;
+                    return *this;
+                }
+                while (index_ == 0 && node_->parent) {
+                    index_ = node_->position;
+                    node_ = node_->parent;
+                }
+                --index_;
+                return *this;
+            }
+
+            Iterator operator--(int) {
+                auto copy = *this;
+                --*this;
+                return copy;
+            }
+
+            bool operator==(const Iterator& other) const {
+                return node_ == other.node_ && index_ == other.index_;
+            }
+
+           private:
+            friend class BTreeSet;
+
+            const Node* node_;
+            std::size_t index_;
+
+            Iterator(const Node* node, std::size_t index)
+                : node_(node), index_(index) {
+            }
+        };
+
+       private:
+        Iterator make_iterator(Position pos) const {
+            return pos.node ? Iterator(pos.node, pos.index) : end();
+        }
+
+        template <typename K>
+        Iterator lower_bound_iter(const K& key) const {
+            auto result = end();
+            for (auto node = root_; node;) {
+                auto i = lower_index(node, key);
+                if (i < node->count) {
+                    result = Iterator(node, i);
+                    if (!comp_(key, node->keys()[i])) {
+                        break;
+                    }
+                }
+                if (node->leaf) {
+                    break;
+                }
+                node = children(node)[i];
+            }
+            return result;
+        }
+
+        template <typename K>
+        Iterator upper_bound_iter(const K& key) const {
+            auto result = end();
+            for (auto node = root_; node;) {
+                auto i = upper_index(node, key);
+                if (i < node->count) {
+                    result = Iterator(node, i);
+                }
+                if (node->leaf) {
+                    break;
+                }
+                node = children(node)[i];
+            }
+            return result;
+        }
+
+       public:
+        BTreeSet() : BTreeSet(Compare()) {
+        }
+
+        explicit BTreeSet(
+            const Compare& comp,
+            const Allocator& alloc = Allocator())
+            : root_(nullptr), size_(0), comp_(comp), alloc_(alloc) {
+        }
+
+        explicit BTreeSet(const Allocator& alloc)
+            : BTreeSet(Compare(), alloc) {
+        }
+
+        template <std::input_iterator It>
+        BTreeSet(
+            It first,
+            It last,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : BTreeSet(comp, alloc) {
+            for (; first != last; ++first) {
+                insert(*first);
+            }
+        }
+
+        BTreeSet(
+            std::initializer_list<T> list,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : BTreeSet(list.begin(), list.end(), comp, alloc) {
+        }
+
+        BTreeSet(const BTreeSet& other)
+            : root_(nullptr),
+              size_(other.size_),
+              comp_(other.comp_),
+              alloc_(alloc_traits::select_on_container_copy_construction(
+                  other.alloc_)) {
+            if (other.root_) {
+                root_ = clone(other.root_, nullptr, 0);
+            }
+        }
+
+        BTreeSet(BTreeSet&& other) noexcept
+            : root_(other.root_),
+              size_(other.size_),
+              comp_(std::move(other.comp_)),
+              alloc_(std::move(other.alloc_)) {
+            other.root_ = nullptr;
+            other.size_ = 0;
+        }
+
+        BTreeSet& operator=(const BTreeSet& other) {
+            if (this != &other) {
+                clear();
+                comp_ = other.comp_;
+                if constexpr (alloc_traits::
+                                  propagate_on_container_copy_assignment::
+                                      value) {
+                    alloc_ = other.alloc_;
+                }
+                if (other.root_) {
+                    root_ = clone(other.root_, nullptr, 0);
+                    size_ = other.size_;
+                }
+            }
+            return *this;
+        }
+
+        BTreeSet& operator=(BTreeSet&& other) noexcept(
+            alloc_traits::propagate_on_container_move_assignment::value
+            || alloc_traits::is_always_equal::value) {
+            if (this == &other) {
+                return *this;
+            }
+            clear();
+            comp_ = std::move(other.comp_);
+            if constexpr (alloc_traits::
+                              propagate_on_container_move_assignment::value) {
+                alloc_ = std::move(other.alloc_);
+            } else if (alloc_ != other.alloc_) {
+                // узлы other нельзя освободить своим аллокатором: ключи
+                // переносятся поэлементно, как в стандартных контейнерах
+                if (other.root_) {
+                    root_ = clone<true>(other.root_, nullptr, 0);
+                    size_ = other.size_;
+                }
+                other.clear();
+                return *this;
+            }
+            root_ = other.root_;
+            size_ = other.size_;
+            other.root_ = nullptr;
+            other.size_ = 0;
+            return *this;
+        }
+
+        ~BTreeSet() {
+            clear();
+        }
+
+        allocator_type get_allocator() const {
+            return alloc_;
+        }
+
+        key_compare key_comp() const {
+            return comp_;
+        }
+
+        value_compare value_comp() const {
+            return comp_;
+        }
+
+        void clear() {
+            if (root_) {
+                destroy_tree(root_);
+                root_ = nullptr;
+                size_ = 0;
+            }
+        }
+
+        bool empty() const {
+            return !size_;
+        }
+
+        std::size_t size() const {
+            return size_;
+        }
+
+        void swap(BTreeSet& other) {
+            std::swap(root_, other.root_);
+            std::swap(size_, other.size_);
+            std::swap(comp_, other.comp_);
+            if constexpr (alloc_traits::propagate_on_container_swap::value) {
+                std::swap(alloc_, other.alloc_);
+            }
+        }
+
+        Iterator begin() const {
+            if (!root_) {
+                return end();
+            }
+            const Node* node = root_;
+            while (!node->leaf) {
+                node = children(node)[0];
+            }
+            return Iterator(node, 0);
+        }
+
+        Iterator end() const {
+            return Iterator(root_, root_ ? root_->count : 0);
+        }
+
+        Iterator max() const {
+            if (!root_) {
+                return end();
+            }
+            const Node* node = root_;
+            while (!node->leaf) {
+                node = children(node)[node->count];
+            }
+            return Iterator(node, node->count - 1);
+        }
+
+        bool contains(const T& key) const {
+            return find_position(key).node != nullptr;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        bool contains(const K& key) const {
+            return find_position(key).node != nullptr;
+        }
+
+        std::size_t count(const T& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t count(const K& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        Iterator find(const T& key) const {
+            return make_iterator(find_position(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator find(const K& key) const {
+            return make_iterator(find_position(key));
+        }
+
+        std::pair<Iterator, bool> insert(const T& key) {
+            return try_emplace(key);
+        }
+
+        std::pair<Iterator, bool> insert(T&& key) {
+            return try_emplace(std::move(key));
+        }
+
+        template <typename... Args>
+        std::pair<Iterator, bool> emplace(Args&&... args) {
+            return try_emplace(T(std::forward<Args>(args)...));
+        }
+
+        // Элемент конструируется из key только если равного key ещё нет
+        // в множестве; T(key) обязан быть эквивалентен key.
+        template <typename K>
+        std::pair<Iterator, bool> try_emplace(K&& key) {
+            if (!root_) {
+                root_ = create_node(true);
+            }
+            auto node = root_;
+            while (true) {
+                auto i = lower_index(node, key);
+                if (i < node->count && !comp_(key, node->keys()[i])) {
+                    return std::make_pair(Iterator(node, i), false);
+                }
+                if (node->leaf) {
+                    auto pos =
+                        insert_at(node, i, T(std::forward<K>(key)), nullptr);
+                    ++size_;
+                    return std::make_pair(Iterator(pos.node, pos.index), true);
+                }
+                node = children(node)[i];
+            }
+        }
+
+        std::size_t erase(const T& key) {
+            return erase_key(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t erase(const K& key) {
+            return erase_key(key);
+        }
+
+        Iterator lower_bound(const T& key) const {
+            return lower_bound_iter(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator lower_bound(const K& key) const {
+            return lower_bound_iter(key);
+        }
+
+        Iterator upper_bound(const T& key) const {
+            return upper_bound_iter(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator upper_bound(const K& key) const {
+            return upper_bound_iter(key);
+        }
+
+        std::pair<Iterator, Iterator> equal_range(const T& key) const {
+            return std::make_pair(lower_bound(key), upper_bound(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::pair<Iterator, Iterator> equal_range(const K& key) const {
+            return std::make_pair(lower_bound(key), upper_bound(key));
+        }
+
+        // Элементы из полуинтервала [lo, hi).
+        template <typename K>
+        Range<Iterator> range(const K& lo, const K& hi) const {
+            auto first = lower_bound_iter(lo);
+            auto last = comp_(lo, hi) ? lower_bound_iter(hi) : first;
+            return Range<Iterator>(first, last);
+        }
+    };
+
+    template <std::input_iterator It>
+    BTreeSet(It, It) -> BTreeSet<std::iter_value_t<It>>;
+
+}  // namespace treeset
@@ -0,0 +1,608 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <libset/treeset.hpp>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace treeset {
+
+    namespace detail {
+
+        // Связи — 32-битные номера узлов в массиве, старший бит parent
+        // хранит цвет.
+        template <typename T>
+        struct IndexNode {
+            T key;
+            std::uint32_t left;
+            std::uint32_t right;
+            std::uint32_t parent;
+        };
+    }  // namespace detail
+
+    // Красно-чёрное дерево, все узлы которого лежат подряд в одном
+    // векторе, а ссылки между ними — 32-битные индексы. Узел Set<int>
+    // занимает 32 байта, здесь — 16; копирование — копия вектора.
+    //
+    // erase переносит последний узел массива на место удалённого, поэтому
+    // делает недействительными все итераторы; insert их сохраняет.
+    template <
+        typename T,
+        typename Compare = std::less<>,
+        typename Allocator = std::allocator<T>>
+    class CompactSet {
+       private:
+        using Node = detail::IndexNode<T>;
+        using node_allocator = typename std::allocator_traits<
+            Allocator>::template rebind_alloc<Node>;
+
+        static constexpr std::uint32_t color_bit = 1u << 31;
+        static constexpr std::uint32_t nil = color_bit - 1;
+
+        std::vector<Node, node_allocator> nodes_;
+        std::uint32_t root_;
+        [[no_unique_address]] Compare comp_;
+
+        Node& at(std::uint32_t i) {
+            return nodes_[i];
+        }
+
+        const Node& at(std::uint32_t i) const {
+            return nodes_[i];
+        }
+
+        std::uint32_t parent(std::uint32_t i) const {
+            return at(i).parent & nil;
+        }
+
+        void set_parent(std::uint32_t i, std::uint32_t p) {
+            at(i).parent = (at(i).parent & color_bit) | p;
+        }
+
+        bool is_red(std::uint32_t i) const {
+            return i != nil && (at(i).parent & color_bit) != 0;
+        }
+
+        void set_color(std::uint32_t i, bool color) {
+            at(i).parent = (at(i).parent & nil) | (color ? color_bit : 0);
+        }
+
+        std::uint32_t min(std::uint32_t i) const {
+            while (at(i).left != nil) {
+                i = at(i).left;
+            }
+            return i;
+        }
+
+        std::uint32_t max(std::uint32_t i) const {
+            while (at(i).right != nil) {
+                i = at(i).right;
+            }
+            return i;
+        }
+
+        std::uint32_t successor(std::uint32_t i) const {
+            if (at(i).right != nil) {
+                return min(at(i).right);
+            }
+            auto p = parent(i);
+            while (p != nil && i == at(p).right) {
+                i = p;
+                p = parent(p);
+            }
+            return p;
+        }
+
+        std::uint32_t predecessor(std::uint32_t i) const {
+            if (at(i).left != nil) {
+                return max(at(i).left);
+            }
+            auto p = parent(i);
+            while (p != nil && i == at(p).left) {
+                i = p;
+                p = parent(p);
+            }
+            return p;
+        }
+
+        // Ставит v на место u у родителя u.
+        void replace_child(std::uint32_t u, std::uint32_t v) {
+            auto p = parent(u);
+            if (p == nil) {
+                root_ = v;
+            } else if (at(p).left == u) {
+                at(p).left = v;
+            } else {
+                at(p).right = v;
+            }
+            if (v != nil) {
+                set_parent(v, p);
+            }
+        }
+
+        void rotate_left(std::uint32_t x) {
+            auto y = at(x).right;
+            at(x).right = at(y).left;
+            if (at(y).left != nil) {
+                set_parent(at(y).left, x);
+            }
+            replace_child(x, y);
+            at(y).left = x;
+            set_parent(x, y);
+        }
+
+        void rotate_right(std::uint32_t x) {
+            auto y = at(x).left;
+            at(x).left = at(y).right;
+            if (at(y).right != nil) {
+                set_parent(at(y).right, x);
+            }
+            replace_child(x, y);
+            at(y).right = x;
+            set_parent(x, y);
+        }
+
+        void insert_fixup(std::uint32_t x) {
+            while (x != root_ && is_red(parent(x))) {
+                auto p = parent(x);
+                auto g = parent(p);
+                bool left = p == at(g).left;
+                auto uncle = left ? at(g).right : at(g).left;
+                if (is_red(uncle)) {
+                    set_color(p, BLACK);
+                    set_color(uncle, BLACK);
+                    set_color(g, RED);
+                    x = g;
+                    continue;
+                }
+                if (x == (left ? at(p).right : at(p).left)) {
+                    x = p;
+                    left ? rotate_left(x) : rotate_right(x);
+                    p = parent(x);
+                }
+                set_color(p, BLACK);
+                set_color(g, RED);
+                left ? rotate_right(g) : rotate_left(g);
+            }
+            set_color(root_, BLACK);
+        }
+
+        // x занял место удалённого чёрного узла и может быть nil, поэтому
+        // его родитель передаётся отдельно.
+        void erase_fixup(std::uint32_t x, std::uint32_t p) {
+            while (x != root_ && !is_red(x)) {
+                bool left = x == at(p).left;
+                auto w = left ? at(p).right : at(p).left;
+                if (is_red(w)) {
+                    set_color(w, BLACK);
+                    set_color(p, RED);
+                    left ? rotate_left(p) : rotate_right(p);
+                    w = left ? at(p).right : at(p).left;
+                }
+                auto inner = left ? at(w).left : at(w).right;
+                auto outer = left ? at(w).right : at(w).left;
+                if (!is_red(inner) && !is_red(outer)) {
+                    set_color(w, RED);
+                    x = p;
+                    p = parent(x);
+                    continue;
+                }
+                if (!is_red(outer)) {
+                    set_color(inner, BLACK);
+                    set_color(w, RED);
+                    left ? rotate_right(w) : rotate_left(w);
+                    w = left ? at(p).right : at(p).left;
+                    outer = left ? at(w).right : at(w).left;
+                }
+                set_color(w, is_red(p));
+                set_color(p, BLACK);
+                set_color(outer, BLACK);
+                left ? rotate_left(p) : rotate_right(p);
+                x = root_;
+            }
+            if (x != nil) {
+                set_color(x, BLACK);
+            }
+        }
+
+        void unlink(std::uint32_t z) {
+            auto removed_red = is_red(z);
+            std::uint32_t x;
+            std::uint32_t p;
+            if (at(z).left == nil || at(z).right == nil) {
+                x = at(z).left == nil ? at(z).right : at(z).left;
+                p = parent(z);
+                replace_child(z, x);
+            } else {
+                auto y = min(at(z).right);
+                removed_red = is_red(y);
+                x = at(y).right;
+                if (parent(y) == z) {
+                    p = y;
+                } else {
+                    p = parent(y);
+                    replace_child(y, x);
+                    at(y).right = at(z).right;
+                    set_parent(at(y).right, y);
+                }
+                replace_child(z, y);
+                at(y).left = at(z).left;
+                set_parent(at(y).left, y);
+                set_color(y, is_red(z));
+            }
+            if (!removed_red) {
+                erase_fixup(x, p);
+            }
+        }
+
+        // Переносит последний узел массива в слот i и укорачивает массив.
+        void release_slot(std::uint32_t i) {
+            auto last = std::uint32_t(nodes_.size() - 1);
+            if (i != last) {
+                at(i) = std::move(at(last));
+                auto p = parent(i);
+                if (p == nil) {
+                    root_ = i;
+                } else if (at(p).left == last) {
+                    at(p).left = i;
+                } else {
+                    at(p).right = i;
+                }
+                if (at(i).left != nil) {
+                    set_parent(at(i).left, i);
+                }
+                if (at(i).right != nil) {
+                    set_parent(at(i).right, i);
+                }
+            }
+            nodes_.pop_back();
+        }
+
+        template <typename K>
+        std::uint32_t lower_bound_index(const K& key) const {
+            auto result = nil;
+            for (auto i = root_; i != nil;) {
+                if (comp_(at(i).key, key)) {
+                    i = at(i).right;
+                } else {
+                    result = i;
+                    i = at(i).left;
+                }
+            }
+            return result;
+        }
+
+        template <typename K>
+        std::uint32_t upper_bound_index(const K& key) const {
+            auto result = nil;
+            for (auto i = root_; i != nil;) {
+                if (comp_(key, at(i).key)) {
+                    result = i;
+                    i = at(i).left;
+                } else {
+                    i = at(i).right;
+                }
+            }
+            return result;
+        }
+
+        template <typename K>
+        std::uint32_t find_index(const K& key) const {
+            auto i = lower_bound_index(key);
+            return i != nil && !comp_(key, at(i).key) ? i : nil;
+        }
+
+        template <typename K>
+        std::size_t erase_key(const K& key) {
+            auto i = find_index(key);
+            if (i == nil) {
+                return 0;
+            }
+            unlink(i);
+            release_slot(i);
+            return 1;
+        }
+
+       public:
+        using key_type = T;
+        using value_type = T;
+        using size_type = std::size_t;
+        using key_compare = Compare;
+        using value_compare = Compare;
+        using allocator_type = Allocator;
+
+        class Iterator {
+           public:
+            using difference_type = std::ptrdiff_t;
+            using value_type = T;
+            using pointer = const T*;
+            using reference = const T&;
+            using iterator_category = std::bidirectional_iterator_tag;
+
+            Iterator() : set_(nullptr), index_(nil) {
+            }
+
+            reference operator*() const {
+                return set_->at(index_).key;
+            }
+
+            pointer operator->() const {
+                return &set_->at(index_).key;
+            }
+
+            Iterator& operator++() {
+                index_ = set_->successor(index_);
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            Iterator& operator--() {
+                index_ = index_ == nil ? set_->max(set_->root_)
+                                       : set_->predecessor(index_);
+                return *this;
+            }
+
+            Iterator operator--(int) {
+                auto copy = *this;
+                --*this;
+                return copy;
+            }
+
+            bool operator==(const Iterator& other) const {
+                return index_ == other.index_;
+            }
+
+           private:
+            friend class CompactSet;
+
+            const CompactSet* set_;
+            std::uint32_t index_;
+
+            Iterator(const CompactSet* set, std::uint32_t index)
+                : set_(set), index_(index) {
+            }
+        };
+
+        using iterator = Iterator;
+        using const_iterator = Iterator;
+
+        // Наибольшее число элементов: индексу остаётся 31 бит.
+        static constexpr std::size_t max_nodes = nil;
+
+        CompactSet() : CompactSet(Compare()) {
+        }
+
+        explicit CompactSet(
+            const Compare& comp,
+            const Allocator& alloc = Allocator())
+            : nodes_(node_allocator(alloc)), root_(nil), comp_(comp) {
+        }
+
+        explicit CompactSet(const Allocator& alloc)
+            : CompactSet(Compare(), alloc) {
+        }
+
+        template <std::input_iterator It>
+        CompactSet(
+            It first,
+            It last,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : CompactSet(comp, alloc) {
+            for (; first != last; ++first) {
+                insert(*first);
+            }
+        }
+
+        CompactSet(
+            std::initializer_list<T> list,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : CompactSet(list.begin(), list.end(), comp, alloc) {
+        }
+
+        CompactSet(const CompactSet& other) = default;
+        CompactSet& operator=(const CompactSet& other) = default;
+
+        CompactSet(CompactSet&& other)
+            : nodes_(std::move(other.nodes_)),
+              root_(std::exchange(other.root_, nil)),
+              comp_(other.comp_) {
+            other.nodes_.clear();
+        }
+
+        CompactSet& operator=(CompactSet&& other) {
+            if (this != &other) {
+                nodes_ = std::move(other.nodes_);
+                root_ = std::exchange(other.root_, nil);
+                comp_ = other.comp_;
+                other.nodes_.clear();
+            }
+            return *this;
+        }
+
+        allocator_type get_allocator() const {
+            return Allocator(nodes_.get_allocator());
+        }
+
+        key_compare key_comp() const {
+            return comp_;
+        }
+
+        value_compare value_comp() const {
+            return comp_;
+        }
+
+        bool empty() const {
+            return nodes_.empty();
+        }
+
+        std::size_t size() const {
+            return nodes_.size();
+        }
+
+        void reserve(std::size_t n) {
+            nodes_.reserve(n);
+        }
+
+        void clear() {
+            nodes_.clear();
+            root_ = nil;
+        }
+
+        void swap(CompactSet& other) {
+            std::swap(nodes_, other.nodes_);
+            std::swap(root_, other.root_);
+            std::swap(comp_, other.comp_);
+        }
+
+        Iterator begin() const {
+            return Iterator(this, root_ == nil ? nil : min(root_));
+        }
+
+        Iterator end() const {
+            return Iterator(this, nil);
+        }
+
+        Iterator max() const {
+            return Iterator(this, root_ == nil ? nil : max(root_));
+        }
+
+        bool contains(const T& key) const {
+            return find_index(key) != nil;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        bool contains(const K& key) const {
+            return find_index(key) != nil;
+        }
+
+        std::size_t count(const T& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t count(const K& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        Iterator find(const T& key) const {
+            return Iterator(this, find_index(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator find(const K& key) const {
+            return Iterator(this, find_index(key));
+        }
+
+        std::pair<Iterator, bool> insert(const T& key) {
+            return try_emplace(key);
+        }
+
+        std::pair<Iterator, bool> insert(T&& key) {
+            return try_emplace(std::move(key));
+        }
+
+        template <typename... Args>
+        std::pair<Iterator, bool> emplace(Args&&... args) {
+            return try_emplace(T(std::forward<Args>(args)...));
+        }
+
+        // Элемент конструируется из key только если равного key ещё нет
+        // в множестве; T(key) обязан быть эквивалентен key.
+        template <typename K>
+        std::pair<Iterator, bool> try_emplace(K&& key) {
+            auto p = nil;
+            bool left = false;
+            for (auto i = root_; i != nil;) {
+                p = i;
+                left = comp_(key, at(i).key);
+                if (!left && !comp_(at(i).key, key)) {
+                    return std::make_pair(Iterator(this, i), false);
+                }
+                i = left ? at(i).left : at(i).right;
+            }
+            if (nodes_.size() == max_nodes) {
+                throw std::length_error("CompactSet: too many elements");
+            }
+            auto i = std::uint32_t(nodes_.size());
+            nodes_.push_back(
+                Node{T(std::forward<K>(key)), nil, nil, p | color_bit});
+            if (p == nil) {
+                root_ = i;
+            } else if (left) {
+                at(p).left = i;
+            } else {
+                at(p).right = i;
+            }
+            insert_fixup(i);
+            return std::make_pair(Iterator(this, i), true);
+        }
+
+        std::size_t erase(const T& key) {
+            return erase_key(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t erase(const K& key) {
+            return erase_key(key);
+        }
+
+        Iterator lower_bound(const T& key) const {
+            return Iterator(this, lower_bound_index(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator lower_bound(const K& key) const {
+            return Iterator(this, lower_bound_index(key));
+        }
+
+        Iterator upper_bound(const T& key) const {
+            return Iterator(this, upper_bound_index(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator upper_bound(const K& key) const {
+            return Iterator(this, upper_bound_index(key));
+        }
+
+        std::pair<Iterator, Iterator> equal_range(const T& key) const {
+            return std::make_pair(lower_bound(key), upper_bound(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::pair<Iterator, Iterator> equal_range(const K& key) const {
+            return std::make_pair(lower_bound(key), upper_bound(key));
+        }
+
+        // Элементы из полуинтервала [lo, hi).
+        template <typename K>
+        Range<Iterator> range(const K& lo, const K& hi) const {
+            auto first = lower_bound_index(lo);
+            auto last = comp_(lo, hi) ? lower_bound_index(hi) : first;
+            return Range<Iterator>(Iterator(this, first), Iterator(this, last));
+        }
+    };
+
+    template <std::input_iterator It>
+    CompactSet(It, It) -> CompactSet<std::iter_value_t<It>>;
+
+}  // namespace treeset
@@ -0,0 +1,526 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <libset/epoch.hpp>
+#include <libset/treeset.hpp>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace treeset {
+
+    // Множество для одновременной работы из многих потоков: ленивый список
+    // с пропусками (Herlihy, Lev, Luchangco, Shavit). Поиск и обход не
+    // берут блокировок, insert и erase блокируют только соседей узла.
+    // Узел сначала помечается удалённым и лишь потом отцепляется, а его
+    // память освобождается, когда его уже не может видеть ни один поток.
+    //
+    // insert, erase и contains линеаризуемы. for_each видит каждый ключ,
+    // присутствовавший на всём протяжении обхода, и не видит ключей,
+    // отсутствовавших всё это время; об остальных гарантий нет. Аллокатор
+    // должен допускать вызовы из нескольких потоков.
+    template <
+        typename T,
+        typename Compare = std::less<>,
+        typename Allocator = std::allocator<T>>
+    class ConcurrentSet {
+       private:
+        static constexpr int max_height = 32;
+        static constexpr std::size_t retire_shards = 16;
+        // Часть списка разбирается, когда в ней прибавляется столько узлов.
+        static constexpr std::size_t retire_batch = 64;
+
+        struct alignas(std::atomic<void*>) Node {
+            std::atomic<bool> marked{false};
+            std::atomic<bool> linked{false};
+            std::atomic_flag busy;
+            int height;
+            alignas(T) unsigned char storage[sizeof(T)];
+
+            explicit Node(int height) : height(height) {
+            }
+
+            T& key() {
+                return *std::launder(reinterpret_cast<T*>(storage));
+            }
+
+            // Ссылки уровней лежат сразу за узлом.
+            std::atomic<Node*>* next() {
+                return reinterpret_cast<std::atomic<Node*>*>(this + 1);
+            }
+
+            void lock() {
+                while (busy.test_and_set(std::memory_order_acquire)) {
+                    while (busy.test(std::memory_order_relaxed)) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+
+            void unlock() {
+                busy.clear(std::memory_order_release);
+            }
+        };
+
+        struct Retired {
+            Node* node;
+            std::uint64_t epoch;
+        };
+
+        struct alignas(64) RetireShard {
+            std::mutex mutex;
+            std::vector<Retired> nodes;
+        };
+
+        using node_allocator =
+            typename std::allocator_traits<Allocator>::template rebind_alloc<
+                Node>;
+        using node_traits = std::allocator_traits<node_allocator>;
+
+        [[no_unique_address]] node_allocator alloc_;
+        [[no_unique_address]] Compare comp_;
+        Node* head_;
+        // Высота самого высокого узла за всё время, поиск начинается с неё.
+        std::atomic<int> height_;
+        std::atomic<std::size_t> size_;
+        RetireShard retired_[retire_shards];
+
+        static std::size_t units(int height) {
+            auto bytes = std::size_t(height) * sizeof(std::atomic<Node*>);
+            return 1 + (bytes + sizeof(Node) - 1) / sizeof(Node);
+        }
+
+        Node* allocate(int height) {
+            auto node = node_traits::allocate(alloc_, units(height));
+            ::new (static_cast<void*>(node)) Node(height);
+            for (int level = 0; level < height; level++) {
+                ::new (static_cast<void*>(node->next() + level))
+                    std::atomic<Node*>(nullptr);
+            }
+            return node;
+        }
+
+        void deallocate(Node* node) {
+            auto height = node->height;
+            node->~Node();
+            node_traits::deallocate(alloc_, node, units(height));
+        }
+
+        template <typename... Args>
+        Node* create(Args&&... args) {
+            auto node = allocate(random_height());
+            try {
+                ::new (static_cast<void*>(node->storage))
+                    T(std::forward<Args>(args)...);
+            } catch (...) {
+                deallocate(node);
+                throw;
+            }
+            return node;
+        }
+
+        void destroy(Node* node) {
+            node->key().~T();
+            deallocate(node);
+        }
+
+        // Высота с вероятностью 2^-h больше h.
+        static int random_height() {
+            thread_local std::uint64_t state =
+                std::hash<std::thread::id>()(std::this_thread::get_id())
+                | 1;
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return std::countr_one(state) % max_height + 1;
+        }
+
+        void raise_height(int height) {
+            auto current = height_.load(std::memory_order_relaxed);
+            while (current < height
+                   && !height_.compare_exchange_weak(
+                       current, height, std::memory_order_relaxed)) {
+            }
+        }
+
+        static bool visible(Node* node) {
+            return node->linked.load(std::memory_order_acquire)
+                && !node->marked.load(std::memory_order_acquire);
+        }
+
+        // Соседи key на уровнях ниже top: preds[l] < key <= succs[l].
+        // Возвращает верхний уровень, на котором нашёлся key, или -1.
+        template <typename K>
+        int find(const K& key, int top, Node** preds, Node** succs) const {
+            int found = -1;
+            auto pred = head_;
+            // узел, уже оказавшийся не меньше key на уровне выше
+            Node* bound = nullptr;
+            for (int level = top - 1; level >= 0; level--) {
+                auto curr = pred->next()[level].load(std::memory_order_acquire);
+                while (curr && curr != bound && comp_(curr->key(), key)) {
+                    pred = curr;
+                    curr = pred->next()[level].load(std::memory_order_acquire);
+                }
+                if (found == -1 && curr && !comp_(key, curr->key())) {
+                    found = level;
+                }
+                bound = curr;
+                preds[level] = pred;
+                succs[level] = curr;
+            }
+            return found;
+        }
+
+        // Первый узел с ключом не меньше key, включая помеченные.
+        template <typename K>
+        Node* lower(const K& key) const {
+            auto pred = head_;
+            Node* bound = nullptr;
+            for (int level = height_.load(std::memory_order_relaxed) - 1;
+                 level >= 0; level--) {
+                auto curr = pred->next()[level].load(std::memory_order_acquire);
+                while (curr && curr != bound && comp_(curr->key(), key)) {
+                    pred = curr;
+                    curr = pred->next()[level].load(std::memory_order_acquire);
+                }
+                bound = curr;
+            }
+            return bound;
+        }
+
+        static void unlock(Node** preds, int highest) {
+            Node* prev = nullptr;
+            for (int level = 0; level <= highest; level++) {
+                if (preds[level] != prev) {
+                    prev = preds[level];
+                    prev->unlock();
+                }
+            }
+        }
+
+        // Блокирует preds снизу вверх и проверяет, что на уровнях ниже
+        // height они всё ещё ссылаются на succs (или на victim). Возвращает
+        // верхний заблокированный уровень; при неудаче всё отпускает и
+        // возвращает -1.
+        static int lock(
+            Node** preds,
+            Node** succs,
+            Node* victim,
+            int height) {
+            int highest = -1;
+            Node* prev = nullptr;
+            for (int level = 0; level < height; level++) {
+                auto pred = preds[level];
+                auto succ = victim ? victim : succs[level];
+                if (pred != prev) {
+                    pred->lock();
+                    highest = level;
+                    prev = pred;
+                }
+                bool valid = !pred->marked.load(std::memory_order_acquire)
+                    && pred->next()[level].load(std::memory_order_acquire)
+                        == succ
+                    && (victim || !succ
+                        || !succ->marked.load(std::memory_order_acquire));
+                if (!valid) {
+                    unlock(preds, highest);
+                    return -1;
+                }
+            }
+            return highest;
+        }
+
+        // key ссылается либо на внешний ключ, либо на ключ node; узел
+        // создаётся через make, только когда ключа точно нет.
+        template <typename K, typename Make>
+        bool insert_node(const K& key, Node* node, Make make) {
+            Node* preds[max_height];
+            Node* succs[max_height];
+            while (true) {
+                auto top = height_.load(std::memory_order_relaxed);
+                if (node) {
+                    top = std::max(top, node->height);
+                }
+                auto found = node
+                    ? find(node->key(), top, preds, succs)
+                    : find(key, top, preds, succs);
+                if (found != -1) {
+                    auto existing = succs[found];
+                    if (existing->marked.load(std::memory_order_acquire)) {
+                        continue;
+                    }
+                    while (!existing->linked.load(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                    }
+                    if (node) {
+                        destroy(node);
+                    }
+                    return false;
+                }
+                if (!node) {
+                    node = make();
+                    continue;
+                }
+
+                auto height = node->height;
+                auto highest = lock(preds, succs, nullptr, height);
+                if (highest == -1) {
+                    continue;
+                }
+                raise_height(height);
+                for (int level = 0; level < height; level++) {
+                    node->next()[level].store(
+                        succs[level], std::memory_order_relaxed);
+                }
+                for (int level = 0; level < height; level++) {
+                    preds[level]->next()[level].store(
+                        node, std::memory_order_release);
+                }
+                node->linked.store(true, std::memory_order_release);
+                unlock(preds, highest);
+                size_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        template <typename K>
+        std::size_t erase_key(const K& key) {
+            Node* preds[max_height];
+            Node* succs[max_height];
+            Node* victim = nullptr;
+            auto top = height_.load(std::memory_order_relaxed);
+            while (true) {
+                auto found = find(
+                    victim ? victim->key() : key, top, preds, succs);
+                if (!victim) {
+                    if (found == -1) {
+                        return 0;
+                    }
+                    auto node = succs[found];
+                    if (node->height > top) {
+                        top = node->height;
+                        continue;
+                    }
+                    if (!node->linked.load(std::memory_order_acquire)
+                        || node->height - 1 != found
+                        || node->marked.load(std::memory_order_acquire)) {
+                        return 0;
+                    }
+                    node->lock();
+                    if (node->marked.load(std::memory_order_relaxed)) {
+                        node->unlock();
+                        return 0;
+                    }
+                    node->marked.store(true, std::memory_order_release);
+                    victim = node;
+                }
+
+                auto height = victim->height;
+                auto highest = lock(preds, succs, victim, height);
+                if (highest == -1) {
+                    continue;
+                }
+                for (int level = height - 1; level >= 0; level--) {
+                    preds[level]->next()[level].store(
+                        victim->next()[level].load(std::memory_order_relaxed),
+                        std::memory_order_release);
+                }
+                victim->unlock();
+                unlock(preds, highest);
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                retire(victim);
+                return 1;
+            }
+        }
+
+        void retire(Node* node) {
+            auto id = std::this_thread::get_id();
+            auto index = std::hash<std::thread::id>()(id) % retire_shards;
+            auto& shard = retired_[index];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.nodes.push_back(Retired{node, detail::Epoch::current()});
+            if (shard.nodes.size() % retire_batch != 0) {
+                return;
+            }
+            auto now = detail::Epoch::advance();
+            std::erase_if(shard.nodes, [&](const Retired& retired) {
+                if (!detail::Epoch::reclaimable(retired.epoch, now)) {
+                    return false;
+                }
+                destroy(retired.node);
+                return true;
+            });
+        }
+
+       public:
+        using key_type = T;
+        using value_type = T;
+        using size_type = std::size_t;
+        using key_compare = Compare;
+        using value_compare = Compare;
+        using allocator_type = Allocator;
+
+        ConcurrentSet() : ConcurrentSet(Compare()) {
+        }
+
+        explicit ConcurrentSet(
+            const Compare& comp,
+            const Allocator& alloc = Allocator())
+            : alloc_(alloc), comp_(comp), head_(allocate(max_height)),
+              height_(1), size_(0) {
+        }
+
+        template <std::input_iterator It>
+        ConcurrentSet(
+            It first,
+            It last,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : ConcurrentSet(comp, alloc) {
+            for (; first != last; ++first) {
+                insert(*first);
+            }
+        }
+
+        ConcurrentSet(
+            std::initializer_list<T> list,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : ConcurrentSet(list.begin(), list.end(), comp, alloc) {
+        }
+
+        ConcurrentSet(const ConcurrentSet&) = delete;
+        ConcurrentSet& operator=(const ConcurrentSet&) = delete;
+
+        // Вызывается, когда другие потоки уже закончили работу с множеством.
+        ~ConcurrentSet() {
+            auto node = head_->next()[0].load(std::memory_order_relaxed);
+            while (node) {
+                auto next = node->next()[0].load(std::memory_order_relaxed);
+                destroy(node);
+                node = next;
+            }
+            for (auto& shard : retired_) {
+                for (auto& retired : shard.nodes) {
+                    destroy(retired.node);
+                }
+            }
+            deallocate(head_);
+        }
+
+        allocator_type get_allocator() const {
+            return allocator_type(alloc_);
+        }
+
+        key_compare key_comp() const {
+            return comp_;
+        }
+
+        value_compare value_comp() const {
+            return comp_;
+        }
+
+        // При одновременных изменениях — значение на какой-то момент
+        // в пределах вызова.
+        std::size_t size() const {
+            return size_.load(std::memory_order_relaxed);
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        bool insert(const T& key) {
+            detail::Epoch::Guard guard;
+            return insert_node(key, nullptr, [&] { return create(key); });
+        }
+
+        bool insert(T&& key) {
+            detail::Epoch::Guard guard;
+            return insert_node(
+                key, nullptr, [&] { return create(std::move(key)); });
+        }
+
+        template <typename... Args>
+        bool emplace(Args&&... args) {
+            detail::Epoch::Guard guard;
+            auto node = create(std::forward<Args>(args)...);
+            return insert_node(node->key(), node, [] { return nullptr; });
+        }
+
+        std::size_t erase(const T& key) {
+            detail::Epoch::Guard guard;
+            return erase_key(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t erase(const K& key) {
+            detail::Epoch::Guard guard;
+            return erase_key(key);
+        }
+
+        bool contains(const T& key) const {
+            return count(key) == 1;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        bool contains(const K& key) const {
+            return count(key) == 1;
+        }
+
+        std::size_t count(const T& key) const {
+            detail::Epoch::Guard guard;
+            auto node = lower(key);
+            return node && !comp_(key, node->key()) && visible(node) ? 1 : 0;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t count(const K& key) const {
+            detail::Epoch::Guard guard;
+            auto node = lower(key);
+            return node && !comp_(key, node->key()) && visible(node) ? 1 : 0;
+        }
+
+        // Вызывает f для ключей по возрастанию.
+        template <typename F>
+        void for_each(F f) const {
+            detail::Epoch::Guard guard;
+            for (auto node = head_->next()[0].load(std::memory_order_acquire);
+                 node; node = node->next()[0].load(std::memory_order_acquire)) {
+                if (visible(node)) {
+                    f(std::as_const(node->key()));
+                }
+            }
+        }
+
+        // Вызывает f для ключей из полуинтервала [lo, hi) по возрастанию.
+        template <typename K, typename F>
+        void for_each(const K& lo, const K& hi, F f) const {
+            detail::Epoch::Guard guard;
+            for (auto node = lower(lo); node && comp_(node->key(), hi);
+                 node = node->next()[0].load(std::memory_order_acquire)) {
+                if (visible(node)) {
+                    f(std::as_const(node->key()));
+                }
+            }
+        }
+    };
+
+    template <std::input_iterator It>
+    ConcurrentSet(It, It) -> ConcurrentSet<std::iter_value_t<It>>;
+
+}  // namespace treeset
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+namespace treeset {
+
+    namespace detail {
+
+        // Эпохи для отложенного освобождения памяти в конкурентных
+        // контейнерах. Поток закрепляется в текущей эпохе на время
+        // операции; узел, отцепленный в эпоху e, можно освободить, когда
+        // глобальная эпоха дошла до e + 2: к этому моменту все потоки,
+        // которые могли его видеть, уже открепились.
+        class Epoch {
+           public:
+            // Закрепление на время жизни объекта, вложенные допустимы.
+            class Guard {
+               public:
+                Guard();
+                ~Guard();
+
+                Guard(const Guard&) = delete;
+                Guard& operator=(const Guard&) = delete;
+            };
+
+            static std::uint64_t current();
+
+            // Сдвигает эпоху, если все закреплённые потоки её догнали.
+            // Возвращает эпоху после попытки.
+            static std::uint64_t advance();
+
+            static bool reclaimable(std::uint64_t retired, std::uint64_t now) {
+                return retired + 2 <= now;
+            }
+        };
+    }  // namespace detail
+
+}  // namespace treeset
@@ -0,0 +1,437 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <libset/treeset.hpp>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace treeset {
+
+    namespace detail {
+
+        inline void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(address);
+#else
+            (void)address;
+#endif
+        }
+    }  // namespace detail
+
+    // Неизменяемое множество в раскладке Эйтцингера: ключ с индексом k
+    // (с единицы) имеет детей 2k и 2k + 1, то есть дерево лежит в массиве
+    // по уровням. Спуск не ветвится, а потомки на несколько уровней вперёд
+    // занимают одну кэш-линию и подгружаются заранее. Получается из
+    // Set::freeze() или напрямую из диапазона.
+    template <
+        typename T,
+        typename Compare = std::less<>,
+        typename Allocator = std::allocator<T>>
+    class FrozenSet {
+       private:
+        static constexpr std::size_t cache_line = 64;
+        // Через столько уровней потомки k лежат подряд с индекса k << ahead.
+        static constexpr int ahead = std::max(
+            1, int(std::bit_width(cache_line / sizeof(T))) - 1);
+        // Столько поисков contains(first, last, out) идут одновременно.
+        static constexpr std::size_t lanes = 8;
+
+        // keys_[0] — копия первого ключа, чтобы индексы шли с единицы.
+        std::vector<T, Allocator> keys_;
+        [[no_unique_address]] Compare comp_;
+
+        // Размер поддерева с корнем j: все уровни, кроме последнего,
+        // заполнены, последний заполнен слева направо до n.
+        static std::size_t subtree_size(std::size_t j, std::size_t n) {
+            if (j > n) {
+                return 0;
+            }
+            auto below = std::bit_width(n) - std::bit_width(j);
+            auto first = j << below;
+            auto last_level = first > n
+                ? 0
+                : std::min(n - first + 1, std::size_t(1) << below);
+            return (std::size_t(1) << below) - 1 + last_level;
+        }
+
+        // Номер ключа k в порядке возрастания; n для k == 0.
+        static std::size_t rank_of(std::size_t k, std::size_t n) {
+            if (k == 0) {
+                return n;
+            }
+            auto rank = subtree_size(2 * k, n);
+            for (; k > 1; k >>= 1) {
+                if (k & 1) {
+                    rank += subtree_size(k - 1, n) + 1;
+                }
+            }
+            return rank;
+        }
+
+        // Спуск до листа: вправо, пока go_right(ключ) истинно. Последний
+        // поворот налево указывает на ответ, 0 — ответа нет.
+        template <typename Predicate>
+        std::size_t descend(Predicate go_right) const {
+            auto keys = keys_.data();
+            auto n = size();
+            std::size_t k = 1;
+            while (k <= n) {
+                detail::prefetch(keys + std::min(k << ahead, n));
+                k = 2 * k + std::size_t(go_right(keys[k]));
+            }
+            return k >> (std::countr_one(k) + 1);
+        }
+
+        template <typename K>
+        std::size_t lower_index(const K& key) const {
+            return descend([&](const T& x) { return comp_(x, key); });
+        }
+
+        template <typename K>
+        std::size_t upper_index(const K& key) const {
+            return descend([&](const T& x) { return !comp_(key, x); });
+        }
+
+        template <typename K>
+        std::size_t find_index(const K& key) const {
+            auto k = lower_index(key);
+            return k != 0 && !comp_(key, keys_[k]) ? k : 0;
+        }
+
+        // sorted строго возрастает. Симметричный обход неявного дерева
+        // по индексам за O(n) сопоставляет каждому узлу k номер его ключа
+        // в sorted, затем ключи переносятся в порядке индексов.
+        void build(std::vector<T>& sorted) {
+            auto n = sorted.size();
+            if (n == 0) {
+                return;
+            }
+            std::vector<std::size_t> rank(n + 1);
+            std::size_t k = 1;
+            for (std::size_t r = 0; r < n; r++) {
+                if (r == 0) {
+                    while (2 * k <= n) {
+                        k *= 2;
+                    }
+                } else if (2 * k + 1 <= n) {
+                    // самый левый узел правого поддерева
+                    k = 2 * k + 1;
+                    while (2 * k <= n) {
+                        k *= 2;
+                    }
+                } else {
+                    // подъём, пока k — правый сын
+                    k >>= std::countr_one(k) + 1;
+                }
+                rank[k] = r;
+            }
+            keys_.reserve(n + 1);
+            keys_.push_back(sorted.front());
+            for (k = 1; k <= n; k++) {
+                keys_.push_back(std::move(sorted[rank[k]]));
+            }
+        }
+
+       public:
+        using key_type = T;
+        using value_type = T;
+        using size_type = std::size_t;
+        using key_compare = Compare;
+        using value_compare = Compare;
+        using allocator_type = Allocator;
+
+        class Iterator {
+           public:
+            using difference_type = std::ptrdiff_t;
+            using value_type = T;
+            using pointer = const T*;
+            using reference = const T&;
+            using iterator_category = std::bidirectional_iterator_tag;
+
+            Iterator() : keys_(nullptr), size_(0), index_(0) {
+            }
+
+            reference operator*() const {
+                return keys_[index_];
+            }
+
+            pointer operator->() const {
+                return keys_ + index_;
+            }
+
+            Iterator& operator++() {
+                if (2 * index_ + 1 <= size_) {
+                    index_ = 2 * index_ + 1;
+                    while (2 * index_ <= size_) {
+                        index_ *= 2;
+                    }
+                } else {
+                    index_ >>= std::countr_one(index_) + 1;
+                }
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            Iterator& operator--() {
+                if (index_ == 0) {
+                    index_ = 1;
+                    while (2 * index_ + 1 <= size_) {
+                        index_ = 2 * index_ + 1;
+                    }
+                } else if (2 * index_ <= size_) {
+                    index_ *= 2;
+                    while (2 * index_ + 1 <= size_) {
+                        index_ = 2 * index_ + 1;
+                    }
+                } else {
+                    index_ >>= std::countr_zero(index_) + 1;
+                }
+                return *this;
+            }
+
+            Iterator operator--(int) {
+                auto copy = *this;
+                --*this;
+                return copy;
+            }
+
+            bool operator==(const Iterator& other) const {
+                return index_ == other.index_;
+            }
+
+           private:
+            friend class FrozenSet;
+
+            // index_ == 0 — конец.
+            const T* keys_;
+            std::size_t size_;
+            std::size_t index_;
+
+            Iterator(const T* keys, std::size_t size, std::size_t index)
+                : keys_(keys), size_(size), index_(index) {
+            }
+        };
+
+        using iterator = Iterator;
+        using const_iterator = Iterator;
+
+       private:
+        Iterator make_iterator(std::size_t index) const {
+            return Iterator(keys_.data(), size(), index);
+        }
+
+       public:
+        FrozenSet() : FrozenSet(Compare()) {
+        }
+
+        explicit FrozenSet(
+            const Compare& comp,
+            const Allocator& alloc = Allocator())
+            : keys_(alloc), comp_(comp) {
+        }
+
+        template <std::input_iterator It>
+        FrozenSet(
+            It first,
+            It last,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : FrozenSet(comp, alloc) {
+            auto sorted = detail::sorted_unique<T>(first, last, comp_);
+            build(sorted);
+        }
+
+        FrozenSet(
+            std::initializer_list<T> list,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : FrozenSet(list.begin(), list.end(), comp, alloc) {
+        }
+
+        // Диапазон должен быть строго возрастающим относительно comp.
+        template <std::input_iterator It>
+        static FrozenSet from_sorted(
+            It first,
+            It last,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator()) {
+            FrozenSet set(comp, alloc);
+            std::vector<T> sorted(first, last);
+            set.build(sorted);
+            return set;
+        }
+
+        allocator_type get_allocator() const {
+            return keys_.get_allocator();
+        }
+
+        key_compare key_comp() const {
+            return comp_;
+        }
+
+        value_compare value_comp() const {
+            return comp_;
+        }
+
+        bool empty() const {
+            return keys_.empty();
+        }
+
+        std::size_t size() const {
+            return keys_.empty() ? 0 : keys_.size() - 1;
+        }
+
+        Iterator begin() const {
+            if (empty()) {
+                return end();
+            }
+            std::size_t k = 1;
+            while (2 * k <= size()) {
+                k *= 2;
+            }
+            return make_iterator(k);
+        }
+
+        Iterator end() const {
+            return make_iterator(0);
+        }
+
+        Iterator max() const {
+            return empty() ? end() : --end();
+        }
+
+        bool contains(const T& key) const {
+            return find_index(key) != 0;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        bool contains(const K& key) const {
+            return find_index(key) != 0;
+        }
+
+        // Пакетный contains: lanes поисков спускаются по уровням вместе,
+        // их загрузки независимы и перекрываются, а для арифметических
+        // ключей шаг по всем дорожкам векторизуется. В out пишется bool
+        // на каждый ключ из [first, last).
+        template <std::input_iterator It, typename Out>
+        requires std::default_initializable<std::iter_value_t<It>>
+        Out contains(It first, It last, Out out) const {
+            auto keys = keys_.data();
+            auto n = size();
+            std::iter_value_t<It> queries[lanes];
+            std::size_t index[lanes];
+            while (first != last) {
+                std::size_t used = 0;
+                for (; used < lanes && first != last; ++used, ++first) {
+                    queries[used] = *first;
+                }
+                for (std::size_t lane = 0; lane < used; lane++) {
+                    index[lane] = 1;
+                }
+                for (auto level = std::bit_width(n); level > 0; level--) {
+                    for (std::size_t lane = 0; lane < used; lane++) {
+                        auto k = index[lane];
+                        bool right = comp_(keys[std::min(k, n)], queries[lane]);
+                        index[lane] = k <= n ? 2 * k + right : k;
+                    }
+                }
+                for (std::size_t lane = 0; lane < used; lane++) {
+                    auto k = index[lane];
+                    k >>= std::countr_one(k) + 1;
+                    *out++ = k != 0 && !comp_(queries[lane], keys[k]);
+                }
+            }
+            return out;
+        }
+
+        std::size_t count(const T& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t count(const K& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        Iterator find(const T& key) const {
+            return make_iterator(find_index(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator find(const K& key) const {
+            return make_iterator(find_index(key));
+        }
+
+        Iterator lower_bound(const T& key) const {
+            return make_iterator(lower_index(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator lower_bound(const K& key) const {
+            return make_iterator(lower_index(key));
+        }
+
+        Iterator upper_bound(const T& key) const {
+            return make_iterator(upper_index(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator upper_bound(const K& key) const {
+            return make_iterator(upper_index(key));
+        }
+
+        std::pair<Iterator, Iterator> equal_range(const T& key) const {
+            return std::make_pair(lower_bound(key), upper_bound(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::pair<Iterator, Iterator> equal_range(const K& key) const {
+            return std::make_pair(lower_bound(key), upper_bound(key));
+        }
+
+        // Элементы из полуинтервала [lo, hi).
+        template <typename K>
+        Range<Iterator> range(const K& lo, const K& hi) const {
+            auto first = lower_index(lo);
+            auto last = comp_(lo, hi) ? lower_index(hi) : first;
+            return Range<Iterator>(make_iterator(first), make_iterator(last));
+        }
+
+        // Число элементов, меньших key.
+        template <typename K>
+        std::size_t rank(const K& key) const {
+            return rank_of(lower_index(key), size());
+        }
+
+        // Позиция элемента в порядке возрастания, size() для end().
+        std::size_t rank(Iterator it) const {
+            return rank_of(it.index_, size());
+        }
+
+        void swap(FrozenSet& other) {
+            std::swap(keys_, other.keys_);
+            std::swap(comp_, other.comp_);
+        }
+    };
+
+    template <std::input_iterator It>
+    FrozenSet(It, It) -> FrozenSet<std::iter_value_t<It>>;
+
+}  // namespace treeset
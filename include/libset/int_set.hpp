@@ -0,0 +1,599 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <libset/treeset.hpp>
+#include <limits>
+#include <memory>
+#include <utility>
+
+namespace treeset {
+
+    // Множество беззнаковых целых на префиксном дереве с ветвлением 64:
+    // каждый уровень разбирает 6 бит ключа, а узел хранит битовую маску
+    // непустых детей и плотный массив только этих детей. Поиск, вставка,
+    // удаление и переход к соседнему ключу делают не больше
+    // ceil(digits / 6) шагов (6 для 32-битных ключей, 11 для 64-битных),
+    // каждый — несколько битовых операций без сравнений ключей.
+    //
+    // Итератор хранит сам ключ, поэтому остаётся действительным, пока
+    // этот ключ есть в множестве. Ключ отдаётся по значению: ссылка на
+    // поле итератора повисла бы, как только копия итератора исчезнет
+    // (std::reverse_iterator разыменовывает именно временную копию).
+    // Поэтому по старой классификации итератор лишь входной, а для
+    // концептов C++20 — двунаправленный.
+    template <std::unsigned_integral T, typename Allocator = std::allocator<T>>
+    class IntSet {
+       private:
+        static constexpr int digits = std::numeric_limits<T>::digits;
+        static constexpr int levels = (digits + 5) / 6;
+
+        // На последнем уровне bits — сами ключи, детей нет.
+        struct Node {
+            std::uint64_t bits;
+            Node* children;
+        };
+
+        using alloc_traits = std::allocator_traits<Allocator>;
+        using node_allocator =
+            typename alloc_traits::template rebind_alloc<Node>;
+        using node_alloc_traits = std::allocator_traits<node_allocator>;
+
+        Node root_;
+        std::size_t size_;
+        [[no_unique_address]] node_allocator alloc_;
+
+        static constexpr int shift(int level) {
+            return (levels - 1 - level) * 6;
+        }
+
+        static unsigned digit(T key, int level) {
+            return unsigned(key >> shift(level)) & 63;
+        }
+
+        static T with_digit(T prefix, unsigned d, int level) {
+            return prefix | (T(d) << shift(level));
+        }
+
+        // Маски битов строго выше и строго ниже d.
+        static std::uint64_t above(unsigned d) {
+            return d == 63 ? 0 : ~std::uint64_t(0) << (d + 1);
+        }
+
+        static std::uint64_t below(unsigned d) {
+            return (std::uint64_t(1) << d) - 1;
+        }
+
+        static std::size_t index(const Node& node, unsigned d) {
+            return std::size_t(std::popcount(node.bits & below(d)));
+        }
+
+        // Ёмкость массива детей — степень двойки не меньше их числа.
+        static std::size_t capacity(const Node& node) {
+            return std::bit_ceil(std::size_t(std::popcount(node.bits)));
+        }
+
+        Node& add_child(Node& node, unsigned d) {
+            auto count = std::size_t(std::popcount(node.bits));
+            auto i = index(node, d);
+            if (count == 0 || std::has_single_bit(count)) {
+                auto children =
+                    node_alloc_traits::allocate(alloc_, count ? 2 * count : 1);
+                std::copy(node.children, node.children + i, children);
+                std::copy(
+                    node.children + i, node.children + count,
+                    children + i + 1);
+                if (count) {
+                    node_alloc_traits::deallocate(
+                        alloc_, node.children, count);
+                }
+                node.children = children;
+            } else {
+                std::copy_backward(
+                    node.children + i, node.children + count,
+                    node.children + count + 1);
+            }
+            node.bits |= std::uint64_t(1) << d;
+            node.children[i] = Node{0, nullptr};
+            return node.children[i];
+        }
+
+        void remove_child(Node& node, unsigned d) {
+            auto old_capacity = capacity(node);
+            auto count = std::size_t(std::popcount(node.bits)) - 1;
+            auto i = index(node, d);
+            node.bits &= ~(std::uint64_t(1) << d);
+            if (count == 0) {
+                node_alloc_traits::deallocate(
+                    alloc_, node.children, old_capacity);
+                node.children = nullptr;
+            } else if (std::has_single_bit(count)) {
+                auto children = node_alloc_traits::allocate(alloc_, count);
+                std::copy(node.children, node.children + i, children);
+                std::copy(
+                    node.children + i + 1, node.children + count + 1,
+                    children + i);
+                node_alloc_traits::deallocate(
+                    alloc_, node.children, old_capacity);
+                node.children = children;
+            } else {
+                std::copy(
+                    node.children + i + 1, node.children + count + 1,
+                    node.children + i);
+            }
+        }
+
+        void destroy(Node& node, int level) {
+            if (level == levels - 1 || !node.bits) {
+                return;
+            }
+            auto count = std::size_t(std::popcount(node.bits));
+            for (std::size_t i = 0; i < count; i++) {
+                destroy(node.children[i], level + 1);
+            }
+            node_alloc_traits::deallocate(
+                alloc_, node.children, capacity(node));
+        }
+
+        Node clone(const Node& node, int level) {
+            Node copy{node.bits, nullptr};
+            if (level == levels - 1 || !node.bits) {
+                return copy;
+            }
+            auto count = std::size_t(std::popcount(node.bits));
+            copy.children =
+                node_alloc_traits::allocate(alloc_, capacity(node));
+            for (std::size_t i = 0; i < count; i++) {
+                copy.children[i] = clone(node.children[i], level + 1);
+            }
+            return copy;
+        }
+
+        bool insert_key(T key) {
+            auto node = &root_;
+            for (int level = 0; level < levels - 1; level++) {
+                auto d = digit(key, level);
+                if (node->bits >> d & 1) {
+                    node = &node->children[index(*node, d)];
+                } else {
+                    node = &add_child(*node, d);
+                }
+            }
+            auto bit = std::uint64_t(1) << digit(key, levels - 1);
+            if (node->bits & bit) {
+                return false;
+            }
+            node->bits |= bit;
+            ++size_;
+            return true;
+        }
+
+        // Опустевшие узлы удаляются на обратном ходе рекурсии.
+        bool erase_key(Node& node, int level, T key) {
+            auto d = digit(key, level);
+            if (!(node.bits >> d & 1)) {
+                return false;
+            }
+            if (level == levels - 1) {
+                node.bits &= ~(std::uint64_t(1) << d);
+                return true;
+            }
+            auto& child = node.children[index(node, d)];
+            if (!erase_key(child, level + 1, key)) {
+                return false;
+            }
+            if (!child.bits) {
+                remove_child(node, d);
+            }
+            return true;
+        }
+
+        bool contains_key(T key) const {
+            auto node = &root_;
+            for (int level = 0; level < levels - 1; level++) {
+                auto d = digit(key, level);
+                if (!(node->bits >> d & 1)) {
+                    return false;
+                }
+                node = &node->children[index(*node, d)];
+            }
+            return node->bits >> digit(key, levels - 1) & 1;
+        }
+
+        static T min_key(const Node* node, int level, T prefix) {
+            for (; level < levels - 1; level++) {
+                auto d = unsigned(std::countr_zero(node->bits));
+                prefix = with_digit(prefix, d, level);
+                node = &node->children[0];
+            }
+            return with_digit(
+                prefix, unsigned(std::countr_zero(node->bits)), level);
+        }
+
+        static T max_key(const Node* node, int level, T prefix) {
+            for (; level < levels - 1; level++) {
+                auto d = unsigned(63 - std::countl_zero(node->bits));
+                prefix = with_digit(prefix, d, level);
+                node = &node->children[std::popcount(node->bits) - 1];
+            }
+            return with_digit(
+                prefix, unsigned(63 - std::countl_zero(node->bits)), level);
+        }
+
+        // Наименьший ключ поддерева, не меньший key.
+        static bool successor(
+            const Node& node,
+            int level,
+            T key,
+            T prefix,
+            T& result) {
+            auto d = digit(key, level);
+            if (level == levels - 1) {
+                auto bits = node.bits & ~below(d);
+                if (!bits) {
+                    return false;
+                }
+                result = with_digit(
+                    prefix, unsigned(std::countr_zero(bits)), level);
+                return true;
+            }
+            if (node.bits >> d & 1
+                && successor(
+                    node.children[index(node, d)], level + 1, key,
+                    with_digit(prefix, d, level), result)) {
+                return true;
+            }
+            auto bits = node.bits & above(d);
+            if (!bits) {
+                return false;
+            }
+            auto next = unsigned(std::countr_zero(bits));
+            result = min_key(
+                &node.children[index(node, next)], level + 1,
+                with_digit(prefix, next, level));
+            return true;
+        }
+
+        // Наибольший ключ поддерева, не больший key.
+        static bool predecessor(
+            const Node& node,
+            int level,
+            T key,
+            T prefix,
+            T& result) {
+            auto d = digit(key, level);
+            if (level == levels - 1) {
+                auto bits = node.bits & (below(d) | std::uint64_t(1) << d);
+                if (!bits) {
+                    return false;
+                }
+                result = with_digit(
+                    prefix, unsigned(63 - std::countl_zero(bits)), level);
+                return true;
+            }
+            if (node.bits >> d & 1
+                && predecessor(
+                    node.children[index(node, d)], level + 1, key,
+                    with_digit(prefix, d, level), result)) {
+                return true;
+            }
+            auto bits = node.bits & below(d);
+            if (!bits) {
+                return false;
+            }
+            auto prev = unsigned(63 - std::countl_zero(bits));
+            result = max_key(
+                &node.children[index(node, prev)], level + 1,
+                with_digit(prefix, prev, level));
+            return true;
+        }
+
+       public:
+        using key_type = T;
+        using value_type = T;
+        using key_compare = std::less<T>;
+        using value_compare = std::less<T>;
+        using allocator_type = Allocator;
+
+        class Iterator {
+           public:
+            // Хранит копию ключа для operator->.
+            class Arrow {
+               public:
+                const T* operator->() const {
+                    return &key_;
+                }
+
+               private:
+                friend class Iterator;
+
+                T key_;
+
+                explicit Arrow(T key) : key_(key) {
+                }
+            };
+
+            using difference_type = std::ptrdiff_t;
+            using value_type = T;
+            using pointer = Arrow;
+            using reference = T;
+            using iterator_category = std::input_iterator_tag;
+            using iterator_concept = std::bidirectional_iterator_tag;
+
+            Iterator() : owner_(nullptr), key_(0), end_(true) {
+            }
+
+            reference operator*() const {
+                return key_;
+            }
+
+            pointer operator->() const {
+                return Arrow(key_);
+            }
+
+            Iterator& operator++() {
+                end_ = key_ == std::numeric_limits<T>::max()
+                    || !successor(owner_->root_, 0, key_ + 1, 0, key_);
+                if (end_) {
+                    key_ = 0;
+                }
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            // С конца переходит к наибольшему ключу.
+            Iterator& operator--() {
+                if (end_) {
+                    key_ = owner_->max_key(&owner_->root_, 0, 0);
+                    end_ = false;
+                } else {
+                    predecessor(owner_->root_, 0, key_ - 1, 0, key_);
+                }
+                return *this;
+            }
+
+            Iterator operator--(int) {
+                auto copy = *this;
+                --*this;
+                return copy;
+            }
+
+            bool operator==(const Iterator& other) const {
+                return end_ == other.end_ && key_ == other.key_;
+            }
+
+           private:
+            friend class IntSet;
+
+            const IntSet* owner_;
+            T key_;
+            bool end_;
+
+            Iterator(const IntSet* owner, T key, bool end)
+                : owner_(owner), key_(end ? 0 : key), end_(end) {
+            }
+        };
+
+        using iterator = Iterator;
+        using const_iterator = Iterator;
+
+        IntSet() : IntSet(Allocator()) {
+        }
+
+        explicit IntSet(const Allocator& alloc)
+            : root_{0, nullptr}, size_(0), alloc_(alloc) {
+        }
+
+        template <std::input_iterator It>
+        IntSet(It first, It last, const Allocator& alloc = Allocator())
+            : IntSet(alloc) {
+            for (; first != last; ++first) {
+                insert(*first);
+            }
+        }
+
+        IntSet(
+            std::initializer_list<T> list,
+            const Allocator& alloc = Allocator())
+            : IntSet(list.begin(), list.end(), alloc) {
+        }
+
+        IntSet(const IntSet& other)
+            : root_{0, nullptr},
+              size_(other.size_),
+              alloc_(node_alloc_traits::select_on_container_copy_construction(
+                  other.alloc_)) {
+            root_ = clone(other.root_, 0);
+        }
+
+        IntSet(IntSet&& other) noexcept
+            : root_(other.root_),
+              size_(other.size_),
+              alloc_(std::move(other.alloc_)) {
+            other.root_ = Node{0, nullptr};
+            other.size_ = 0;
+        }
+
+        // Узлы всегда выделяет alloc_ этого множества, поэтому копия
+        // строится уже после того, как аллокатор заменён по правилам
+        // propagate_on_container_copy_assignment.
+        IntSet& operator=(const IntSet& other) {
+            if (this != &other) {
+                clear();
+                if constexpr (node_alloc_traits::
+                                  propagate_on_container_copy_assignment::
+                                      value) {
+                    alloc_ = other.alloc_;
+                }
+                root_ = clone(other.root_, 0);
+                size_ = other.size_;
+            }
+            return *this;
+        }
+
+        IntSet& operator=(IntSet&& other) noexcept(
+            node_alloc_traits::propagate_on_container_move_assignment::value
+            || node_alloc_traits::is_always_equal::value) {
+            if (this == &other) {
+                return *this;
+            }
+            clear();
+            if constexpr (node_alloc_traits::
+                              propagate_on_container_move_assignment::value) {
+                alloc_ = std::move(other.alloc_);
+            } else if (alloc_ != other.alloc_) {
+                // чужие узлы нельзя освободить своим аллокатором:
+                // дерево копируется, как в стандартных контейнерах
+                root_ = clone(other.root_, 0);
+                size_ = other.size_;
+                other.clear();
+                return *this;
+            }
+            root_ = other.root_;
+            size_ = other.size_;
+            other.root_ = Node{0, nullptr};
+            other.size_ = 0;
+            return *this;
+        }
+
+        ~IntSet() {
+            clear();
+        }
+
+        allocator_type get_allocator() const {
+            return Allocator(alloc_);
+        }
+
+        key_compare key_comp() const {
+            return key_compare();
+        }
+
+        value_compare value_comp() const {
+            return value_compare();
+        }
+
+        void clear() {
+            destroy(root_, 0);
+            root_ = Node{0, nullptr};
+            size_ = 0;
+        }
+
+        bool empty() const {
+            return !size_;
+        }
+
+        std::size_t size() const {
+            return size_;
+        }
+
+        void swap(IntSet& other) {
+            std::swap(root_, other.root_);
+            std::swap(size_, other.size_);
+            if constexpr (node_alloc_traits::propagate_on_container_swap::
+                              value) {
+                std::swap(alloc_, other.alloc_);
+            }
+        }
+
+        Iterator begin() const {
+            if (!size_) {
+                return end();
+            }
+            return Iterator(this, min_key(&root_, 0, 0), false);
+        }
+
+        Iterator end() const {
+            return Iterator(this, 0, true);
+        }
+
+        Iterator max() const {
+            if (!size_) {
+                return end();
+            }
+            return Iterator(this, max_key(&root_, 0, 0), false);
+        }
+
+        bool contains(T key) const {
+            return contains_key(key);
+        }
+
+        std::size_t count(T key) const {
+            return contains_key(key) ? 1 : 0;
+        }
+
+        Iterator find(T key) const {
+            return Iterator(this, key, !contains_key(key));
+        }
+
+        std::pair<Iterator, bool> insert(T key) {
+            auto inserted = insert_key(key);
+            return std::make_pair(Iterator(this, key, false), inserted);
+        }
+
+        std::pair<Iterator, bool> emplace(T key) {
+            return insert(key);
+        }
+
+        std::size_t erase(T key) {
+            if (!erase_key(root_, 0, key)) {
+                return 0;
+            }
+            --size_;
+            return 1;
+        }
+
+        // Возвращает итератор на следующий ключ.
+        Iterator erase(Iterator position) {
+            auto next = std::next(position);
+            erase(*position);
+            return next;
+        }
+
+        // Первый ключ, не меньший key, — переход к преемнику.
+        Iterator lower_bound(T key) const {
+            T result = 0;
+            auto found = successor(root_, 0, key, 0, result);
+            return Iterator(this, result, !found);
+        }
+
+        Iterator upper_bound(T key) const {
+            if (key == std::numeric_limits<T>::max()) {
+                return end();
+            }
+            return lower_bound(key + 1);
+        }
+
+        std::pair<Iterator, Iterator> equal_range(T key) const {
+            return std::make_pair(lower_bound(key), upper_bound(key));
+        }
+
+        // Последний ключ, не больший key, или end().
+        Iterator floor(T key) const {
+            T result = 0;
+            auto found = predecessor(root_, 0, key, 0, result);
+            return Iterator(this, result, !found);
+        }
+
+        // Элементы из полуинтервала [lo, hi).
+        Range<Iterator> range(T lo, T hi) const {
+            auto first = lower_bound(lo);
+            auto last = lo < hi ? lower_bound(hi) : first;
+            return Range<Iterator>(first, last);
+        }
+    };
+
+    template <std::input_iterator It>
+    IntSet(It, It) -> IntSet<std::iter_value_t<It>>;
+
+}  // namespace treeset
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace treeset {
+
+    namespace detail {
+
+        // Пул узлов: узлы выделяются чанками через аллокатор контейнера,
+        // освобождённые узлы переиспользуются через freelist, а release()
+        // возвращает все чанки разом.
+        template <typename Node, typename Allocator>
+        class NodePool {
+           private:
+            using alloc_traits = std::allocator_traits<Allocator>;
+
+            struct Chunk {
+                Chunk* next;
+                std::size_t capacity;
+            };
+
+            struct FreeSlot {
+                FreeSlot* next;
+            };
+
+            static_assert(sizeof(Chunk) <= sizeof(Node));
+            static_assert(sizeof(FreeSlot) <= sizeof(Node));
+
+            static const std::size_t min_chunk = 16;
+            static const std::size_t max_chunk = 4096;
+
+            Allocator alloc_;
+            Chunk* chunks_;
+            FreeSlot* free_;
+            Node* bump_;
+            Node* bump_end_;
+            std::size_t next_chunk_;
+
+            void grow(std::size_t slots) {
+                // первый слот чанка занят его заголовком
+                Node* data = alloc_traits::allocate(alloc_, slots + 1);
+                chunks_ =
+                    ::new (static_cast<void*>(data)) Chunk{chunks_, slots};
+                bump_ = data + 1;
+                bump_end_ = data + 1 + slots;
+            }
+
+            void push_free(Node* node) {
+                free_ = ::new (static_cast<void*>(node)) FreeSlot{free_};
+            }
+
+            void reset() {
+                chunks_ = nullptr;
+                free_ = nullptr;
+                bump_ = nullptr;
+                bump_end_ = nullptr;
+                next_chunk_ = min_chunk;
+            }
+
+           public:
+            explicit NodePool(const Allocator& alloc = Allocator())
+                : alloc_(alloc),
+                  chunks_(nullptr),
+                  free_(nullptr),
+                  bump_(nullptr),
+                  bump_end_(nullptr),
+                  next_chunk_(min_chunk) {
+            }
+
+            NodePool(const NodePool&) = delete;
+            NodePool& operator=(const NodePool&) = delete;
+
+            NodePool(NodePool&& other) noexcept
+                : alloc_(std::move(other.alloc_)),
+                  chunks_(other.chunks_),
+                  free_(other.free_),
+                  bump_(other.bump_),
+                  bump_end_(other.bump_end_),
+                  next_chunk_(other.next_chunk_) {
+                other.reset();
+            }
+
+            // Забирает чанки other. Если аллокатор не переходит вместе с
+            // ними, аллокаторы должны быть равны: иначе память other
+            // освобождалась бы чужим аллокатором, и контейнер переносит
+            // элементы поэлементно, не вызывая этот оператор.
+            NodePool& operator=(NodePool&& other) noexcept {
+                if (this != &other) {
+                    if constexpr (!alloc_traits::
+                                      propagate_on_container_move_assignment::
+                                          value) {
+                        assert(alloc_ == other.alloc_);
+                    }
+                    release();
+                    if constexpr (alloc_traits::
+                                      propagate_on_container_move_assignment::
+                                          value) {
+                        alloc_ = std::move(other.alloc_);
+                    }
+                    chunks_ = other.chunks_;
+                    free_ = other.free_;
+                    bump_ = other.bump_;
+                    bump_end_ = other.bump_end_;
+                    next_chunk_ = other.next_chunk_;
+                    other.reset();
+                }
+                return *this;
+            }
+
+            ~NodePool() {
+                release();
+            }
+
+            const Allocator& get_allocator() const {
+                return alloc_;
+            }
+
+            Allocator& get_allocator() {
+                return alloc_;
+            }
+
+            template <typename... Args>
+            Node* create(Args&&... args) {
+                Node* node;
+                if (free_) {
+                    node = reinterpret_cast<Node*>(free_);
+                    free_ = free_->next;
+                } else {
+                    if (bump_ == bump_end_) {
+                        grow(next_chunk_);
+                        if (next_chunk_ < max_chunk) {
+                            next_chunk_ *= 2;
+                        }
+                    }
+                    node = bump_++;
+                }
+                alloc_traits::construct(
+                    alloc_, node, std::forward<Args>(args)...);
+                return node;
+            }
+
+            // Следующие n узлов будут выделены без обращений к аллокатору;
+            // если freelist пуст, они лягут подряд в одном чанке.
+            void reserve(std::size_t n) {
+                if (std::size_t(bump_end_ - bump_) < n) {
+                    // остаток текущего чанка не должен пропасть до release()
+                    while (bump_ != bump_end_) {
+                        push_free(bump_++);
+                    }
+                    grow(n < next_chunk_ ? next_chunk_ : n);
+                }
+            }
+
+            void destroy(Node* node) {
+                alloc_traits::destroy(alloc_, node);
+                push_free(node);
+            }
+
+            // Выделяет n подряд идущих слотов без объектов. Слоты можно
+            // заполнять через construct() из разных потоков, неиспользованные
+            // возвращаются через release_batch().
+            Node* allocate_batch(std::size_t n) {
+                reserve(n);
+                Node* slots = bump_;
+                bump_ += n;
+                return slots;
+            }
+
+            template <typename... Args>
+            void construct(Node* slot, Args&&... args) {
+                alloc_traits::construct(
+                    alloc_, slot, std::forward<Args>(args)...);
+            }
+
+            // Разрушает объект, не возвращая слот; слот затем отдаётся
+            // через recycle().
+            void destroy_value(Node* node) {
+                alloc_traits::destroy(alloc_, node);
+            }
+
+            void recycle(Node* slot) {
+                push_free(slot);
+            }
+
+            // Возвращает слоты [slots + used, slots + n) последнего
+            // allocate_batch(n); если после него ничего не выделялось, они
+            // снова становятся свободным местом чанка.
+            void release_batch(Node* slots, std::size_t used, std::size_t n) {
+                if (bump_ == slots + n) {
+                    bump_ = slots + used;
+                    return;
+                }
+                for (auto slot = slots + used; slot != slots + n; ++slot) {
+                    push_free(slot);
+                }
+            }
+
+            // Забирает чанки other вместе с живыми в них узлами; other
+            // остаётся пустым. Аллокаторы пулов должны быть равны.
+            void splice(NodePool& other) {
+                if (!other.chunks_) {
+                    return;
+                }
+                while (other.bump_ != other.bump_end_) {
+                    push_free(other.bump_++);
+                }
+                auto tail = other.chunks_;
+                while (tail->next) {
+                    tail = tail->next;
+                }
+                tail->next = chunks_;
+                chunks_ = other.chunks_;
+                while (other.free_) {
+                    auto slot = other.free_;
+                    other.free_ = slot->next;
+                    free_ = ::new (static_cast<void*>(slot)) FreeSlot{free_};
+                }
+                other.reset();
+            }
+
+            // Возвращает аллокатору все чанки. Ключи живых узлов должны
+            // быть уже разрушены.
+            void release() {
+                while (chunks_) {
+                    auto chunk = chunks_;
+                    chunks_ = chunk->next;
+                    alloc_traits::deallocate(
+                        alloc_, reinterpret_cast<Node*>(chunk),
+                        chunk->capacity + 1);
+                }
+                reset();
+            }
+        };
+    }  // namespace detail
+
+}  // namespace treeset
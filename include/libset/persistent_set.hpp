@@ -0,0 +1,709 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <libset/treeset.hpp>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace treeset {
+
+    namespace detail {
+
+        // Узел неизменяемого дерева: после публикации меняется только
+        // счетчик ссылок, поэтому узел может входить в несколько множеств.
+        template <typename T>
+        struct PersistentNode {
+            T key;
+            PersistentNode* left;
+            PersistentNode* right;
+            std::atomic<std::uint32_t> refs;
+            std::uint8_t height;
+
+            template <typename... Args>
+            explicit PersistentNode(std::in_place_t, Args&&... args)
+                : key(std::forward<Args>(args)...),
+                  left(nullptr),
+                  right(nullptr),
+                  refs(1),
+                  height(1) {
+            }
+        };
+    }  // namespace detail
+
+    // Множество со структурным разделением узлов: копирование за O(1),
+    // insert/erase копируют только путь от корня, O(log n) узлов; копии
+    // не видят изменений друг друга. Дерево AVL: балансировка на
+    // обратном ходе рекурсии проще всего переносится на копирование пути.
+    // Узлы, принадлежащие только этому множеству, меняются на месте.
+    //
+    // Копии можно читать и уничтожать из разных потоков; изменять один
+    // объект одновременно из нескольких потоков нельзя. Аллокаторы всех
+    // копий должны быть равны — узел освобождает последний владелец.
+    template <
+        typename T,
+        typename Compare = std::less<>,
+        typename Allocator = std::allocator<T>>
+    class PersistentSet {
+       private:
+        using Node = detail::PersistentNode<T>;
+        using node_allocator = typename std::allocator_traits<
+            Allocator>::template rebind_alloc<Node>;
+        using node_alloc_traits = std::allocator_traits<node_allocator>;
+
+        // Высота AVL-дерева из 2^64 элементов меньше 1.45 * 64.
+        static const std::size_t max_height = 96;
+
+        Node* root_;
+        std::size_t size_;
+        [[no_unique_address]] Compare comp_;
+        [[no_unique_address]] node_allocator alloc_;
+
+        template <typename... Args>
+        Node* create(Args&&... args) {
+            auto node = node_alloc_traits::allocate(alloc_, 1);
+            node_alloc_traits::construct(
+                alloc_, node, std::in_place, std::forward<Args>(args)...);
+            return node;
+        }
+
+        void free_node(Node* node) {
+            node_alloc_traits::destroy(alloc_, node);
+            node_alloc_traits::deallocate(alloc_, node, 1);
+        }
+
+        static Node* retain(Node* node) {
+            if (node) {
+                node->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+            return node;
+        }
+
+        void release(Node* node) {
+            if (node &&
+                node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                release(node->left);
+                release(node->right);
+                free_node(node);
+            }
+        }
+
+        static bool is_unique(const Node* node) {
+            return node->refs.load(std::memory_order_acquire) == 1;
+        }
+
+        static std::size_t height(const Node* node) {
+            return node ? node->height : 0;
+        }
+
+        static void update(Node* node) {
+            node->height = std::uint8_t(
+                std::max(height(node->left), height(node->right)) + 1);
+        }
+
+        // Делает узел, на который у нас есть ссылка, собственным: общий
+        // узел заменяется копией.
+        Node* own(Node* node) {
+            if (is_unique(node)) {
+                return node;
+            }
+            auto copy = create(node->key);
+            copy->left = retain(node->left);
+            copy->right = retain(node->right);
+            copy->height = node->height;
+            release(node);
+            return copy;
+        }
+
+        // Узел на пути изменения с новым ребенком. owned — ссылку на узел
+        // держит собственный родитель (ее можно отпустить), unique —
+        // узел можно менять на месте.
+        Node* with_left(Node* node, bool owned, bool unique, Node* left) {
+            if (unique) {
+                node->left = left;
+                return node;
+            }
+            auto copy = create(node->key);
+            copy->left = left;
+            copy->right = retain(node->right);
+            if (owned) {
+                release(node);
+            }
+            return copy;
+        }
+
+        Node* with_right(Node* node, bool owned, bool unique, Node* right) {
+            if (unique) {
+                node->right = right;
+                return node;
+            }
+            auto copy = create(node->key);
+            copy->left = retain(node->left);
+            copy->right = right;
+            if (owned) {
+                release(node);
+            }
+            return copy;
+        }
+
+        // Повороты собственных узлов.
+        static Node* rotate_right(Node* node) {
+            auto left = node->left;
+            node->left = left->right;
+            left->right = node;
+            update(node);
+            update(left);
+            return left;
+        }
+
+        static Node* rotate_left(Node* node) {
+            auto right = node->right;
+            node->right = right->left;
+            right->left = node;
+            update(node);
+            update(right);
+            return right;
+        }
+
+        // node собственный; дети могут быть общими и перед поворотом
+        // копируются.
+        Node* balance(Node* node) {
+            auto left_height = height(node->left);
+            auto right_height = height(node->right);
+            if (left_height > right_height + 1) {
+                auto left = own(node->left);
+                node->left = left;
+                if (height(left->left) < height(left->right)) {
+                    left->right = own(left->right);
+                    node->left = rotate_left(left);
+                }
+                return rotate_right(node);
+            }
+            if (right_height > left_height + 1) {
+                auto right = own(node->right);
+                node->right = right;
+                if (height(right->right) < height(right->left)) {
+                    right->left = own(right->left);
+                    node->right = rotate_right(right);
+                }
+                return rotate_left(node);
+            }
+            update(node);
+            return node;
+        }
+
+        // Возвращает новый корень поддерева или nullptr, если равный
+        // ключ уже есть; found — узел с ключом.
+        template <typename V>
+        Node* insert_node(Node* node, bool owned, V&& key, Node*& found) {
+            if (!node) {
+                found = create(std::forward<V>(key));
+                return found;
+            }
+            bool unique = owned && is_unique(node);
+            if (comp_(key, node->key)) {
+                auto left = insert_node(
+                    node->left, unique, std::forward<V>(key), found);
+                if (!left) {
+                    return nullptr;
+                }
+                return balance(with_left(node, owned, unique, left));
+            }
+            if (comp_(node->key, key)) {
+                auto right = insert_node(
+                    node->right, unique, std::forward<V>(key), found);
+                if (!right) {
+                    return nullptr;
+                }
+                return balance(with_right(node, owned, unique, right));
+            }
+            found = node;
+            return nullptr;
+        }
+
+        // Отрезает минимальный узел поддерева; min — собственный узел с
+        // его ключом.
+        Node* erase_min(Node* node, bool owned, Node*& min) {
+            bool unique = owned && is_unique(node);
+            if (!node->left) {
+                auto right = node->right;
+                if (unique) {
+                    min = node;
+                } else {
+                    min = create(node->key);
+                    retain(right);
+                    if (owned) {
+                        release(node);
+                    }
+                }
+                return right;
+            }
+            auto left = erase_min(node->left, unique, min);
+            return balance(with_left(node, owned, unique, left));
+        }
+
+        template <typename K>
+        Node* erase_node(Node* node, bool owned, const K& key, bool& erased) {
+            if (!node) {
+                return nullptr;
+            }
+            bool unique = owned && is_unique(node);
+            if (comp_(key, node->key)) {
+                auto left = erase_node(node->left, unique, key, erased);
+                if (!erased) {
+                    return node;
+                }
+                return balance(with_left(node, owned, unique, left));
+            }
+            if (comp_(node->key, key)) {
+                auto right = erase_node(node->right, unique, key, erased);
+                if (!erased) {
+                    return node;
+                }
+                return balance(with_right(node, owned, unique, right));
+            }
+            erased = true;
+            auto left = unique ? node->left : retain(node->left);
+            auto right = unique ? node->right : retain(node->right);
+            if (unique) {
+                free_node(node);
+            } else if (owned) {
+                release(node);
+            }
+            if (!left || !right) {
+                return left ? left : right;
+            }
+            Node* min;
+            right = erase_min(right, true, min);
+            min->left = left;
+            min->right = right;
+            return balance(min);
+        }
+
+        template <typename It>
+        Node* build(It first, std::size_t n) {
+            if (n == 0) {
+                return nullptr;
+            }
+            auto left_size = n / 2;
+            auto middle = first + std::iter_difference_t<It>(left_size);
+            auto node = create(std::move(*middle));
+            node->left = build(first, left_size);
+            node->right = build(middle + 1, n - left_size - 1);
+            update(node);
+            return node;
+        }
+
+        template <typename K>
+        const Node* find_node(const K& key) const {
+            auto node = root_;
+            while (node) {
+                if (comp_(key, node->key)) {
+                    node = node->left;
+                } else if (comp_(node->key, key)) {
+                    node = node->right;
+                } else {
+                    return node;
+                }
+            }
+            return nullptr;
+        }
+
+        template <typename K>
+        std::size_t erase_key(const K& key) {
+            bool erased = false;
+            auto root = erase_node(root_, true, key, erased);
+            if (!erased) {
+                return 0;
+            }
+            root_ = root;
+            --size_;
+            return 1;
+        }
+
+       public:
+        using key_type = T;
+        using value_type = T;
+        using key_compare = Compare;
+        using value_compare = Compare;
+        using allocator_type = Allocator;
+
+        // Двунаправленный итератор хранит путь от корня до текущего
+        // узла: родительских ссылок у разделяемых узлов нет.
+        class Iterator {
+           public:
+            using difference_type = std::ptrdiff_t;
+            using value_type = T;
+            using pointer = const T*;
+            using reference = const T&;
+            using iterator_category = std::bidirectional_iterator_tag;
+
+            Iterator() : root_(nullptr), depth_(0) {
+            }
+
+            // копируется только занятая часть пути
+            Iterator(const Iterator& other)
+                : root_(other.root_), depth_(other.depth_) {
+                std::copy_n(other.path_.begin(), depth_, path_.begin());
+            }
+
+            Iterator& operator=(const Iterator& other) {
+                root_ = other.root_;
+                depth_ = other.depth_;
+                std::copy_n(other.path_.begin(), depth_, path_.begin());
+                return *this;
+            }
+
+            reference operator*() const {
+                return path_[depth_ - 1]->key;
+            }
+
+            pointer operator->() const {
+                return &path_[depth_ - 1]->key;
+            }
+
+            Iterator& operator++() {
+                auto node = path_[depth_ - 1];
+                if (node->right) {
+                    path_[depth_++] = node->right;
+                    descend_left();
+                    return *this;
+                }
+                while (depth_ > 1 && path_[depth_ - 2]->right == node) {
+                    node = path_[--depth_ - 1];
+                }
+                --depth_;
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            Iterator& operator--() {
+                if (depth_ == 0) {
+                    path_[depth_++] = root_;
+                    descend_right();
+                    return *this;
+                }
+                auto node = path_[depth_ - 1];
+                if (node->left) {
+                    path_[depth_++] = node->left;
+                    descend_right();
+                    return *this;
+                }
+                while (depth_ > 1 && path_[depth_ - 2]->left == node) {
+                    node = path_[--depth_ - 1];
+                }
+                --depth_;
+                return *this;
+            }
+
+            Iterator operator--(int) {
+                auto copy = *this;
+                --*this;
+                return copy;
+            }
+
+            bool operator==(const Iterator& other) const {
+                return current() == other.current();
+            }
+
+           private:
+            friend class PersistentSet;
+
+            const Node* root_;
+            std::size_t depth_;
+            std::array<const Node*, max_height> path_;
+
+            explicit Iterator(const Node* root) : root_(root), depth_(0) {
+            }
+
+            const Node* current() const {
+                return depth_ ? path_[depth_ - 1] : nullptr;
+            }
+
+            void descend_left() {
+                while (path_[depth_ - 1]->left) {
+                    path_[depth_] = path_[depth_ - 1]->left;
+                    ++depth_;
+                }
+            }
+
+            void descend_right() {
+                while (path_[depth_ - 1]->right) {
+                    path_[depth_] = path_[depth_ - 1]->right;
+                    ++depth_;
+                }
+            }
+        };
+
+       private:
+        // Путь до первого узла, для которого less(node) ложно.
+        template <typename Less>
+        Iterator bound(Less less) const {
+            Iterator iter(root_);
+            std::size_t depth = 0;
+            for (auto node = root_; node;) {
+                iter.path_[iter.depth_++] = node;
+                if (less(node->key)) {
+                    node = node->right;
+                } else {
+                    depth = iter.depth_;
+                    node = node->left;
+                }
+            }
+            iter.depth_ = depth;
+            return iter;
+        }
+
+        template <typename K>
+        Iterator lower_bound_iter(const K& key) const {
+            return bound([this, &key](const T& x) { return comp_(x, key); });
+        }
+
+        template <typename K>
+        Iterator upper_bound_iter(const K& key) const {
+            return bound([this, &key](const T& x) { return !comp_(key, x); });
+        }
+
+        template <typename K>
+        Iterator find_iter(const K& key) const {
+            auto iter = lower_bound_iter(key);
+            if (iter.depth_ && comp_(key, *iter)) {
+                return end();
+            }
+            return iter;
+        }
+
+        template <typename V>
+        std::pair<Iterator, bool> insert_key(V&& key) {
+            Node* found = nullptr;
+            auto root = insert_node(root_, true, std::forward<V>(key), found);
+            if (!root) {
+                return std::make_pair(find_iter(found->key), false);
+            }
+            root_ = root;
+            ++size_;
+            return std::make_pair(find_iter(found->key), true);
+        }
+
+       public:
+        PersistentSet() : PersistentSet(Compare()) {
+        }
+
+        explicit PersistentSet(
+            const Compare& comp,
+            const Allocator& alloc = Allocator())
+            : root_(nullptr), size_(0), comp_(comp), alloc_(alloc) {
+        }
+
+        explicit PersistentSet(const Allocator& alloc)
+            : PersistentSet(Compare(), alloc) {
+        }
+
+        template <std::input_iterator It>
+        PersistentSet(
+            It first,
+            It last,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : PersistentSet(comp, alloc) {
+            auto keys = detail::sorted_unique<T>(first, last, comp_);
+            root_ = build(keys.begin(), keys.size());
+            size_ = keys.size();
+        }
+
+        PersistentSet(
+            std::initializer_list<T> list,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : PersistentSet(list.begin(), list.end(), comp, alloc) {
+        }
+
+        // Снимок за O(1): узлы становятся общими.
+        PersistentSet(const PersistentSet& other)
+            : root_(retain(other.root_)),
+              size_(other.size_),
+              comp_(other.comp_),
+              alloc_(node_alloc_traits::select_on_container_copy_construction(
+                  other.alloc_)) {
+        }
+
+        PersistentSet(PersistentSet&& other) noexcept
+            : root_(other.root_),
+              size_(other.size_),
+              comp_(std::move(other.comp_)),
+              alloc_(std::move(other.alloc_)) {
+            other.root_ = nullptr;
+            other.size_ = 0;
+        }
+
+        PersistentSet& operator=(const PersistentSet& other) {
+            if (this != &other) {
+                retain(other.root_);
+                release(root_);
+                root_ = other.root_;
+                size_ = other.size_;
+                comp_ = other.comp_;
+            }
+            return *this;
+        }
+
+        PersistentSet& operator=(PersistentSet&& other) noexcept {
+            if (this != &other) {
+                release(root_);
+                root_ = other.root_;
+                size_ = other.size_;
+                comp_ = std::move(other.comp_);
+                other.root_ = nullptr;
+                other.size_ = 0;
+            }
+            return *this;
+        }
+
+        ~PersistentSet() {
+            release(root_);
+        }
+
+        allocator_type get_allocator() const {
+            return allocator_type(alloc_);
+        }
+
+        key_compare key_comp() const {
+            return comp_;
+        }
+
+        value_compare value_comp() const {
+            return comp_;
+        }
+
+        bool empty() const {
+            return !size_;
+        }
+
+        std::size_t size() const {
+            return size_;
+        }
+
+        void clear() {
+            release(root_);
+            root_ = nullptr;
+            size_ = 0;
+        }
+
+        void swap(PersistentSet& other) {
+            std::swap(*this, other);
+        }
+
+        Iterator begin() const {
+            Iterator iter(root_);
+            if (root_) {
+                iter.path_[iter.depth_++] = root_;
+                iter.descend_left();
+            }
+            return iter;
+        }
+
+        Iterator end() const {
+            return Iterator(root_);
+        }
+
+        Iterator max() const {
+            Iterator iter(root_);
+            if (root_) {
+                iter.path_[iter.depth_++] = root_;
+                iter.descend_right();
+            }
+            return iter;
+        }
+
+        bool contains(const T& key) const {
+            return find_node(key) != nullptr;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        bool contains(const K& key) const {
+            return find_node(key) != nullptr;
+        }
+
+        std::size_t count(const T& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t count(const K& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        Iterator find(const T& key) const {
+            return find_iter(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator find(const K& key) const {
+            return find_iter(key);
+        }
+
+        Iterator lower_bound(const T& key) const {
+            return lower_bound_iter(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator lower_bound(const K& key) const {
+            return lower_bound_iter(key);
+        }
+
+        Iterator upper_bound(const T& key) const {
+            return upper_bound_iter(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator upper_bound(const K& key) const {
+            return upper_bound_iter(key);
+        }
+
+        // Изменения копируют O(log n) узлов пути, если узлы общие с
+        // другими копиями, и не выделяют памяти сверх нового узла иначе.
+        std::pair<Iterator, bool> insert(const T& key) {
+            return insert_key(key);
+        }
+
+        std::pair<Iterator, bool> insert(T&& key) {
+            return insert_key(std::move(key));
+        }
+
+        template <typename... Args>
+        std::pair<Iterator, bool> emplace(Args&&... args) {
+            return insert_key(T(std::forward<Args>(args)...));
+        }
+
+        std::size_t erase(const T& key) {
+            return erase_key(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t erase(const K& key) {
+            return erase_key(key);
+        }
+    };
+
+    template <std::input_iterator It>
+    PersistentSet(It, It) -> PersistentSet<std::iter_value_t<It>>;
+
+}  // namespace treeset
@@ -0,0 +1,440 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <libset/thread_pool.hpp>
+#include <libset/treeset.hpp>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace treeset {
+
+    // Множество, разбитое на shard_count() деревьев Set по диапазонам
+    // ключей: запись в разные части идёт параллельно, каждая часть под
+    // своей блокировкой. Точечные операции потокобезопасны. Операции
+    // можно копить в очередях частей через submit_* и применять разом
+    // через flush(), по потоку на часть. Когда одна часть становится
+    // заметно больше средней, границы пересчитываются так, чтобы части
+    // снова сравнялись.
+    template <
+        typename T,
+        typename Compare = std::less<>,
+        typename Allocator = std::allocator<T>,
+        unsigned Options = 0>
+    class ShardedSet {
+       private:
+        using shard_set = Set<T, Compare, Allocator, Options>;
+        using set_iterator =
+            decltype(std::declval<const shard_set&>().begin());
+
+        // Часть меньше этого размера не считается перекошенной.
+        static constexpr std::size_t min_skew = 1024;
+
+        struct Shard {
+            mutable std::shared_mutex mutex;
+            shard_set set;
+            std::mutex queue_mutex;
+            std::vector<BatchOp<T>> queue;
+
+            Shard(const Compare& comp, const Allocator& alloc)
+                : set(comp, alloc) {
+            }
+
+            // Очередь применяется одним пакетом: из операций с равными
+            // ключами действует последняя, остальные проходят по дереву
+            // одним проходом пальца. Возвращает, на сколько изменился
+            // размер.
+            std::ptrdiff_t apply() {
+                auto before = set.size();
+                set.apply_batch(queue);
+                queue.clear();
+                return std::ptrdiff_t(set.size()) - std::ptrdiff_t(before);
+            }
+        };
+
+        [[no_unique_address]] Compare comp_;
+        Allocator alloc_;
+        std::vector<std::unique_ptr<Shard>> shards_;
+        // Часть i хранит ключи из [bounds_[i - 1], bounds_[i]); частей,
+        // начиная с bounds_.size() + 1, пока нет в разбиении, и они пусты.
+        std::vector<T> bounds_;
+        // Защищает bounds_: на запись берётся только при перебалансировке.
+        mutable std::shared_mutex layout_;
+        std::atomic<std::size_t> size_;
+
+        template <typename K>
+        std::size_t shard_of(const K& key) const {
+            return std::upper_bound(
+                       bounds_.begin(), bounds_.end(), key,
+                       [this](const K& lhs, const T& rhs) {
+                           return comp_(lhs, rhs);
+                       })
+                - bounds_.begin();
+        }
+
+        // Часть перекошена, если она больше удвоенного среднего по
+        // остальным частям. Сравнение со средним по всем частям при двух
+        // частях почти не срабатывает: удвоенное среднее — это весь размер.
+        bool skewed(std::size_t shard_size) const {
+            auto size = size_.load(std::memory_order_relaxed);
+            auto rest = size > shard_size ? size - shard_size : 0;
+            return shard_size > min_skew
+                && shard_size * (shards_.size() - 1) > 2 * rest;
+        }
+
+        template <typename K>
+        bool insert_key(K&& key) {
+            std::size_t shard_size;
+            bool inserted;
+            {
+                std::shared_lock layout(layout_);
+                auto& shard = *shards_[shard_of(key)];
+                std::unique_lock lock(shard.mutex);
+                inserted = shard.set.insert(std::forward<K>(key)).second;
+                shard_size = shard.set.size();
+                size_.fetch_add(inserted ? 1 : 0, std::memory_order_relaxed);
+            }
+            if (inserted && skewed(shard_size)) {
+                rebalance_skewed();
+            }
+            return inserted;
+        }
+
+        template <typename K>
+        std::size_t erase_key(const K& key) {
+            std::shared_lock layout(layout_);
+            auto& shard = *shards_[shard_of(key)];
+            std::unique_lock lock(shard.mutex);
+            auto erased = shard.set.erase(key);
+            size_.fetch_sub(erased, std::memory_order_relaxed);
+            return erased;
+        }
+
+        template <typename K>
+        bool contains_key(const K& key) const {
+            std::shared_lock layout(layout_);
+            auto& shard = *shards_[shard_of(key)];
+            std::shared_lock lock(shard.mutex);
+            return shard.set.contains(key);
+        }
+
+        template <typename K>
+        void submit(K&& key, typename BatchOp<T>::Kind kind) {
+            std::shared_lock layout(layout_);
+            auto& shard = *shards_[shard_of(key)];
+            std::lock_guard lock(shard.queue_mutex);
+            shard.queue.push_back(BatchOp<T>{kind, T(std::forward<K>(key))});
+        }
+
+        void flush_shards(
+            std::size_t first,
+            std::size_t last,
+            ThreadPool& pool) {
+            if (last - first == 1) {
+                auto& shard = *shards_[first];
+                std::unique_lock lock(shard.mutex);
+                std::lock_guard queue(shard.queue_mutex);
+                size_.fetch_add(
+                    std::size_t(shard.apply()), std::memory_order_relaxed);
+                return;
+            }
+            auto middle = first + (last - first) / 2;
+            pool.invoke(
+                [&] { flush_shards(first, middle, pool); },
+                [&] { flush_shards(middle, last, pool); });
+        }
+
+        // Вызывается под исключительной блокировкой layout_.
+        void redistribute() {
+            std::vector<T> keys;
+            keys.reserve(size());
+            for (auto& shard : shards_) {
+                shard->apply();
+                keys.insert(keys.end(), shard->set.begin(), shard->set.end());
+            }
+            auto n = keys.size();
+            auto parts = n < shards_.size() ? 1 : shards_.size();
+            bounds_.clear();
+            for (std::size_t i = 0; i < shards_.size(); i++) {
+                auto first = keys.begin() + std::min(n, i * n / parts);
+                auto last = i < parts
+                    ? keys.begin() + (i + 1) * n / parts
+                    : first;
+                if (i != 0 && i < parts) {
+                    bounds_.push_back(*first);
+                }
+                shards_[i]->set = shard_set::from_sorted(
+                    std::make_move_iterator(first),
+                    std::make_move_iterator(last), comp_, alloc_);
+            }
+            size_.store(n, std::memory_order_relaxed);
+        }
+
+        // Вызывается под блокировкой layout_: redistribute() заменяет
+        // деревья частей, держа только её.
+        std::size_t locked_shard_size(std::size_t i) const {
+            std::shared_lock lock(shards_[i]->mutex);
+            return shards_[i]->set.size();
+        }
+
+        // Несколько потоков могут заметить перекос одновременно, поэтому
+        // он проверяется заново под блокировкой.
+        void rebalance_skewed() {
+            std::unique_lock layout(layout_);
+            for (auto& shard : shards_) {
+                if (skewed(shard->set.size())) {
+                    redistribute();
+                    return;
+                }
+            }
+        }
+
+       public:
+        using key_type = T;
+        using value_type = T;
+        using key_compare = Compare;
+        using value_compare = Compare;
+        using allocator_type = Allocator;
+
+        // Обход без блокировок: пользоваться, когда нет параллельных
+        // изменений.
+        class Iterator {
+           public:
+            using difference_type = std::ptrdiff_t;
+            using value_type = T;
+            using pointer = const T*;
+            using reference = const T&;
+            using iterator_category = std::forward_iterator_tag;
+
+            Iterator() : owner_(nullptr), shard_(0) {
+            }
+
+            reference operator*() const {
+                return *current_;
+            }
+
+            pointer operator->() const {
+                return &*current_;
+            }
+
+            Iterator& operator++() {
+                ++current_;
+                skip_empty();
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            bool operator==(const Iterator& other) const {
+                return current_ == other.current_;
+            }
+
+           private:
+            friend class ShardedSet;
+
+            const ShardedSet* owner_;
+            std::size_t shard_;
+            set_iterator current_;
+
+            Iterator(
+                const ShardedSet* owner,
+                std::size_t shard,
+                set_iterator current)
+                : owner_(owner), shard_(shard), current_(current) {
+                skip_empty();
+            }
+
+            // С конца части переходит к началу следующей непустой.
+            void skip_empty() {
+                auto& shards = owner_->shards_;
+                while (current_ == shards[shard_]->set.end()
+                       && shard_ + 1 < shards.size()) {
+                    current_ = shards[++shard_]->set.begin();
+                }
+            }
+        };
+
+        using iterator = Iterator;
+        using const_iterator = Iterator;
+
+        // По умолчанию частей столько же, сколько аппаратных потоков.
+        explicit ShardedSet(
+            std::size_t shards = std::max(
+                1u, std::thread::hardware_concurrency()),
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : comp_(comp), alloc_(alloc), size_(0) {
+            for (std::size_t i = 0; i < std::max<std::size_t>(shards, 1);
+                 i++) {
+                shards_.push_back(std::make_unique<Shard>(comp, alloc));
+            }
+        }
+
+        ShardedSet(const ShardedSet&) = delete;
+        ShardedSet& operator=(const ShardedSet&) = delete;
+
+        allocator_type get_allocator() const {
+            return alloc_;
+        }
+
+        key_compare key_comp() const {
+            return comp_;
+        }
+
+        value_compare value_comp() const {
+            return comp_;
+        }
+
+        std::size_t shard_count() const {
+            return shards_.size();
+        }
+
+        // Размер части i; для диагностики перекоса.
+        std::size_t shard_size(std::size_t i) const {
+            std::shared_lock layout(layout_);
+            return locked_shard_size(i);
+        }
+
+        // Без учёта операций, ждущих в очередях.
+        std::size_t size() const {
+            return size_.load(std::memory_order_relaxed);
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        bool insert(const T& key) {
+            return insert_key(key);
+        }
+
+        bool insert(T&& key) {
+            return insert_key(std::move(key));
+        }
+
+        std::size_t erase(const T& key) {
+            return erase_key(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t erase(const K& key) {
+            return erase_key(key);
+        }
+
+        bool contains(const T& key) const {
+            return contains_key(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        bool contains(const K& key) const {
+            return contains_key(key);
+        }
+
+        std::size_t count(const T& key) const {
+            return contains_key(key) ? 1 : 0;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t count(const K& key) const {
+            return contains_key(key) ? 1 : 0;
+        }
+
+        // Ставят операцию в очередь части; применяются в порядке
+        // поступления при flush().
+        void submit_insert(T key) {
+            submit(std::move(key), BatchOp<T>::insert);
+        }
+
+        void submit_erase(T key) {
+            submit(std::move(key), BatchOp<T>::erase);
+        }
+
+        // Применяет очереди всех частей, каждую часть — отдельной задачей.
+        void flush(const Parallel& policy = {}) {
+            bool skew = false;
+            {
+                std::shared_lock layout(layout_);
+                flush_shards(0, shards_.size(), policy.threads());
+                for (std::size_t i = 0; i < shards_.size(); i++) {
+                    skew = skew || skewed(locked_shard_size(i));
+                }
+            }
+            if (skew) {
+                rebalance_skewed();
+            }
+        }
+
+        // Переносит ключи между частями так, чтобы они сравнялись по
+        // размеру; ждущие операции перед этим применяются.
+        void rebalance() {
+            std::unique_lock layout(layout_);
+            redistribute();
+        }
+
+        // Вызывает f для ключей по возрастанию, часть за частью.
+        template <typename F>
+        void for_each(F f) const {
+            std::shared_lock layout(layout_);
+            for (auto& shard : shards_) {
+                std::shared_lock lock(shard->mutex);
+                for (const auto& key : shard->set) {
+                    f(key);
+                }
+            }
+        }
+
+        // Вызывает f для ключей из полуинтервала [lo, hi) по возрастанию;
+        // затрагивает только части, пересекающие диапазон.
+        template <typename K, typename F>
+        void for_each(const K& lo, const K& hi, F f) const {
+            if (!comp_(lo, hi)) {
+                return;
+            }
+            std::shared_lock layout(layout_);
+            auto last = shard_of(hi);
+            for (auto i = shard_of(lo); i <= last; i++) {
+                std::shared_lock lock(shards_[i]->mutex);
+                for (const auto& key : shards_[i]->set.range(lo, hi)) {
+                    f(key);
+                }
+            }
+        }
+
+        Iterator begin() const {
+            return Iterator(this, 0, shards_[0]->set.begin());
+        }
+
+        Iterator end() const {
+            return Iterator(
+                this, shards_.size() - 1, shards_.back()->set.end());
+        }
+
+        // Элементы из полуинтервала [lo, hi); без блокировок, как Iterator.
+        template <typename K>
+        Range<Iterator> range(const K& lo, const K& hi) const {
+            if (!comp_(lo, hi)) {
+                return Range<Iterator>(end(), end());
+            }
+            auto first = shard_of(lo);
+            auto last = shard_of(hi);
+            return Range<Iterator>(
+                Iterator(this, first, shards_[first]->set.lower_bound(lo)),
+                Iterator(this, last, shards_[last]->set.lower_bound(hi)));
+        }
+    };
+
+}  // namespace treeset
@@ -0,0 +1,491 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <libset/treeset.hpp>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace treeset {
+
+    // Множество, которое хранит до N ключей упорядоченным массивом прямо
+    // в объекте и не обращается к аллокатору. Вставка (N + 1)-го ключа
+    // переносит ключи в Set, дальше все операции идут через дерево;
+    // обратно в массив множество возвращается только после clear().
+    //
+    // Пока ключи в массиве, insert и erase сдвигают соседние ключи и
+    // делают недействительными итераторы на них; перенос в дерево
+    // делает недействительными все итераторы.
+    template <
+        typename T,
+        std::size_t N = 16,
+        typename Compare = std::less<>,
+        typename Allocator = std::allocator<T>,
+        unsigned Options = 0>
+    class SmallSet {
+       private:
+        static_assert(N > 0);
+
+        using tree_type = Set<T, Compare, Allocator, Options>;
+        using tree_iterator =
+            decltype(std::declval<const tree_type&>().begin());
+
+        alignas(T) unsigned char storage_[N * sizeof(T)];
+        // Число ключей в массиве; пока есть дерево, всегда 0.
+        std::size_t size_;
+        std::optional<tree_type> tree_;
+        [[no_unique_address]] Compare comp_;
+        [[no_unique_address]] Allocator alloc_;
+
+        T* keys() {
+            return std::launder(reinterpret_cast<T*>(storage_));
+        }
+
+        const T* keys() const {
+            return std::launder(reinterpret_cast<const T*>(storage_));
+        }
+
+        // Число ключей массива, меньших key. Без ветвлений и раннего
+        // выхода: для арифметических ключей цикл векторизуется.
+        template <typename K>
+        std::size_t lower_index(const K& key) const {
+            auto data = keys();
+            std::size_t i = 0;
+            for (std::size_t j = 0; j < size_; j++) {
+                i += comp_(data[j], key) ? 1 : 0;
+            }
+            return i;
+        }
+
+        template <typename K>
+        std::size_t upper_index(const K& key) const {
+            auto data = keys();
+            std::size_t i = 0;
+            for (std::size_t j = 0; j < size_; j++) {
+                i += comp_(key, data[j]) ? 0 : 1;
+            }
+            return i;
+        }
+
+        template <typename K>
+        bool found(std::size_t i, const K& key) const {
+            return i < size_ && !comp_(key, keys()[i]);
+        }
+
+        void destroy_keys() {
+            std::destroy_n(keys(), size_);
+            size_ = 0;
+        }
+
+        void copy_keys(const SmallSet& other) {
+            std::uninitialized_copy_n(other.keys(), other.size_, keys());
+            size_ = other.size_;
+        }
+
+        void move_keys(SmallSet& other) {
+            std::uninitialized_move_n(other.keys(), other.size_, keys());
+            size_ = other.size_;
+            other.destroy_keys();
+        }
+
+        void promote() {
+            tree_.emplace(tree_type::from_sorted(
+                std::make_move_iterator(keys()),
+                std::make_move_iterator(keys() + size_), comp_, alloc_));
+            destroy_keys();
+        }
+
+        // Ставит value на место i, сдвигая ключи [i, size_) вправо.
+        void insert_at(std::size_t i, T&& value) {
+            if (i == size_) {
+                ::new (static_cast<void*>(keys() + i)) T(std::move(value));
+            } else {
+                ::new (static_cast<void*>(keys() + size_))
+                    T(std::move(keys()[size_ - 1]));
+                std::move_backward(
+                    keys() + i, keys() + size_ - 1, keys() + size_);
+                keys()[i] = std::move(value);
+            }
+            ++size_;
+        }
+
+        void erase_at(std::size_t i) {
+            std::move(keys() + i + 1, keys() + size_, keys() + i);
+            std::destroy_at(keys() + size_ - 1);
+            --size_;
+        }
+
+        template <typename K>
+        std::size_t erase_key(const K& key) {
+            if (tree_) {
+                return tree_->erase(key);
+            }
+            auto i = lower_index(key);
+            if (!found(i, key)) {
+                return 0;
+            }
+            erase_at(i);
+            return 1;
+        }
+
+       public:
+        using key_type = T;
+        using value_type = T;
+        using key_compare = Compare;
+        using value_compare = Compare;
+        using allocator_type = Allocator;
+
+        class Iterator {
+           public:
+            using difference_type = std::ptrdiff_t;
+            using value_type = T;
+            using pointer = const T*;
+            using reference = const T&;
+            using iterator_category = std::bidirectional_iterator_tag;
+
+            Iterator() : key_(nullptr) {
+            }
+
+            reference operator*() const {
+                return key_ ? *key_ : *node_;
+            }
+
+            pointer operator->() const {
+                return &**this;
+            }
+
+            Iterator& operator++() {
+                if (key_) {
+                    ++key_;
+                } else {
+                    ++node_;
+                }
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            Iterator& operator--() {
+                if (key_) {
+                    --key_;
+                } else {
+                    --node_;
+                }
+                return *this;
+            }
+
+            Iterator operator--(int) {
+                auto copy = *this;
+                --*this;
+                return copy;
+            }
+
+            bool operator==(const Iterator& other) const {
+                return key_ == other.key_ && node_ == other.node_;
+            }
+
+           private:
+            friend class SmallSet;
+
+            // Ключ массива; nullptr, когда ключи в дереве.
+            const T* key_;
+            tree_iterator node_;
+
+            explicit Iterator(const T* key) : key_(key) {
+            }
+
+            explicit Iterator(tree_iterator node)
+                : key_(nullptr), node_(node) {
+            }
+        };
+
+        using iterator = Iterator;
+        using const_iterator = Iterator;
+
+       private:
+        template <typename K>
+        Iterator lower_bound_iter(const K& key) const {
+            if (tree_) {
+                return Iterator(tree_->lower_bound(key));
+            }
+            return Iterator(keys() + lower_index(key));
+        }
+
+        template <typename K>
+        Iterator upper_bound_iter(const K& key) const {
+            if (tree_) {
+                return Iterator(tree_->upper_bound(key));
+            }
+            return Iterator(keys() + upper_index(key));
+        }
+
+        template <typename K>
+        Iterator find_iter(const K& key) const {
+            if (tree_) {
+                return Iterator(tree_->find(key));
+            }
+            auto i = lower_index(key);
+            return found(i, key) ? Iterator(keys() + i) : end();
+        }
+
+       public:
+        SmallSet() : SmallSet(Compare()) {
+        }
+
+        explicit SmallSet(
+            const Compare& comp,
+            const Allocator& alloc = Allocator())
+            : size_(0), comp_(comp), alloc_(alloc) {
+        }
+
+        explicit SmallSet(const Allocator& alloc)
+            : SmallSet(Compare(), alloc) {
+        }
+
+        template <std::input_iterator It>
+        SmallSet(
+            It first,
+            It last,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : SmallSet(comp, alloc) {
+            for (; first != last; ++first) {
+                insert(*first);
+            }
+        }
+
+        SmallSet(
+            std::initializer_list<T> list,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : SmallSet(list.begin(), list.end(), comp, alloc) {
+        }
+
+        SmallSet(const SmallSet& other)
+            : size_(0),
+              tree_(other.tree_),
+              comp_(other.comp_),
+              alloc_(std::allocator_traits<Allocator>::
+                         select_on_container_copy_construction(
+                             other.alloc_)) {
+            copy_keys(other);
+        }
+
+        SmallSet(SmallSet&& other)
+            : size_(0),
+              tree_(std::move(other.tree_)),
+              comp_(std::move(other.comp_)),
+              alloc_(std::move(other.alloc_)) {
+            other.tree_.reset();
+            move_keys(other);
+        }
+
+        SmallSet& operator=(const SmallSet& other) {
+            if (this != &other) {
+                clear();
+                comp_ = other.comp_;
+                tree_ = other.tree_;
+                copy_keys(other);
+            }
+            return *this;
+        }
+
+        SmallSet& operator=(SmallSet&& other) {
+            if (this != &other) {
+                clear();
+                comp_ = std::move(other.comp_);
+                tree_ = std::move(other.tree_);
+                other.tree_.reset();
+                move_keys(other);
+            }
+            return *this;
+        }
+
+        ~SmallSet() {
+            destroy_keys();
+        }
+
+        allocator_type get_allocator() const {
+            return alloc_;
+        }
+
+        key_compare key_comp() const {
+            return comp_;
+        }
+
+        value_compare value_comp() const {
+            return comp_;
+        }
+
+        // Ключи лежат в массиве внутри объекта, а не в дереве.
+        bool is_inline() const {
+            return !tree_;
+        }
+
+        // Освобождает дерево, если оно было: множество снова хранит
+        // ключи в массиве.
+        void clear() {
+            destroy_keys();
+            tree_.reset();
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        std::size_t size() const {
+            return tree_ ? tree_->size() : size_;
+        }
+
+        void swap(SmallSet& other) {
+            std::swap(*this, other);
+        }
+
+        Iterator begin() const {
+            return tree_ ? Iterator(tree_->begin()) : Iterator(keys());
+        }
+
+        Iterator end() const {
+            return tree_ ? Iterator(tree_->end()) : Iterator(keys() + size_);
+        }
+
+        Iterator max() const {
+            if (tree_) {
+                return Iterator(tree_->max());
+            }
+            return Iterator(keys() + (size_ ? size_ - 1 : 0));
+        }
+
+        bool contains(const T& key) const {
+            return find_iter(key) != end();
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        bool contains(const K& key) const {
+            return find_iter(key) != end();
+        }
+
+        std::size_t count(const T& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t count(const K& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        Iterator find(const T& key) const {
+            return find_iter(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator find(const K& key) const {
+            return find_iter(key);
+        }
+
+        std::pair<Iterator, bool> insert(const T& key) {
+            return try_emplace(key);
+        }
+
+        std::pair<Iterator, bool> insert(T&& key) {
+            return try_emplace(std::move(key));
+        }
+
+        template <typename... Args>
+        std::pair<Iterator, bool> emplace(Args&&... args) {
+            return try_emplace(T(std::forward<Args>(args)...));
+        }
+
+        // Элемент конструируется из key только если равного key ещё нет
+        // в множестве; T(key) обязан быть эквивалентен key.
+        template <typename K>
+        std::pair<Iterator, bool> try_emplace(K&& key) {
+            if (!tree_) {
+                auto i = lower_index(key);
+                if (found(i, key)) {
+                    return std::make_pair(Iterator(keys() + i), false);
+                }
+                if (size_ < N) {
+                    insert_at(i, T(std::forward<K>(key)));
+                    return std::make_pair(Iterator(keys() + i), true);
+                }
+                promote();
+            }
+            auto [node, inserted] = tree_->try_emplace(std::forward<K>(key));
+            return std::make_pair(Iterator(node), inserted);
+        }
+
+        std::size_t erase(const T& key) {
+            return erase_key(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t erase(const K& key) {
+            return erase_key(key);
+        }
+
+        // Возвращает итератор на элемент, следующий за удалённым.
+        Iterator erase(Iterator position) {
+            if (tree_) {
+                return Iterator(tree_->erase(position.node_));
+            }
+            auto i = std::size_t(position.key_ - keys());
+            erase_at(i);
+            return Iterator(keys() + i);
+        }
+
+        Iterator lower_bound(const T& key) const {
+            return lower_bound_iter(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator lower_bound(const K& key) const {
+            return lower_bound_iter(key);
+        }
+
+        Iterator upper_bound(const T& key) const {
+            return upper_bound_iter(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator upper_bound(const K& key) const {
+            return upper_bound_iter(key);
+        }
+
+        std::pair<Iterator, Iterator> equal_range(const T& key) const {
+            return std::make_pair(lower_bound(key), upper_bound(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::pair<Iterator, Iterator> equal_range(const K& key) const {
+            return std::make_pair(lower_bound(key), upper_bound(key));
+        }
+
+        // Элементы из полуинтервала [lo, hi).
+        template <typename K>
+        Range<Iterator> range(const K& lo, const K& hi) const {
+            auto first = lower_bound_iter(lo);
+            auto last = comp_(lo, hi) ? lower_bound_iter(hi) : first;
+            return Range<Iterator>(first, last);
+        }
+    };
+
+    template <std::input_iterator It>
+    SmallSet(It, It) -> SmallSet<std::iter_value_t<It>>;
+
+}  // namespace treeset
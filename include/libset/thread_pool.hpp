@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace treeset {
+
+    // Небольшой пул потоков для fork-join: у каждого потока своя очередь,
+    // свободные потоки крадут задачи из чужих очередей, а ожидающий поток
+    // сам выполняет задачи вместо того, чтобы спать.
+    class ThreadPool {
+       public:
+        explicit ThreadPool(std::size_t threads);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Число рабочих потоков, не считая вызывающего.
+        std::size_t size() const;
+
+        // Общий пул на hardware_concurrency() - 1 потоков.
+        static ThreadPool& global();
+
+        // Выполняет f и g, возможно параллельно, и дожидается обеих.
+        template <typename F, typename G>
+        void invoke(F&& f, G&& g) {
+            if (workers_.empty()) {
+                f();
+                g();
+                return;
+            }
+            Job job(&call<std::remove_reference_t<F>>, &f);
+            push(&job);
+            std::exception_ptr error;
+            try {
+                g();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            wait(&job);
+            if (job.error) {
+                std::rethrow_exception(job.error);
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+       private:
+        struct Job {
+            void (*run)(void*);
+            void* data;
+            std::atomic<bool> done;
+            std::exception_ptr error;
+
+            Job(void (*run_)(void*), void* data_)
+                : run(run_), data(data_), done(false) {
+            }
+        };
+
+        struct Queue;
+
+        template <typename F>
+        static void call(void* data) {
+            (*static_cast<F*>(data))();
+        }
+
+        std::size_t self() const;
+        void push(Job* job);
+        Job* pop(std::size_t index);
+        void execute(Job* job);
+        void wait(Job* job);
+        void work(std::size_t index);
+
+        // Последняя очередь общая для потоков, не входящих в пул.
+        std::vector<std::unique_ptr<Queue>> queues_;
+        std::vector<std::thread> workers_;
+        std::atomic<std::size_t> pending_;
+        std::atomic<bool> stop_;
+        std::mutex sleep_mutex_;
+        std::condition_variable wake_;
+    };
+
+    // Параметры параллельных операций Set: задачи меньше grain элементов
+    // выполняются последовательно, pool == nullptr означает global().
+    struct Parallel {
+        std::size_t grain = 4096;
+        ThreadPool* pool = nullptr;
+
+        ThreadPool& threads() const {
+            return pool ? *pool : ThreadPool::global();
+        }
+    };
+
+}  // namespace treeset
@@ -1,37 +1,135 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
 #include <compare>
+#include <concepts>
+#include <cstdint>
+#include <functional>
 #include <initializer_list>
 #include <iostream>
+#include <iterator>
+#include <libset/node_pool.hpp>
+#include <libset/thread_pool.hpp>
 #include <memory>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace treeset {
 
     static const bool BLACK = false;
     static const bool RED = true;
 
+    // Необязательные расширения узла, передаются последним параметром Set.
+    // order_statistics: размер поддерева в узле, rank/nth и арифметика
+    // итераторов за O(log n).
+    // compact_nodes: цвет хранится в младшем бите указателя на родителя,
+    // узел короче на слово, если ключ не оставляет места под bool.
+    // threaded: узлы прошиты двусвязным списком в порядке ключей, ++ и --
+    // итератора — один переход; операции над множествами и массовое
+    // построение в конце прошивают результат заново за O(n).
+    inline constexpr unsigned order_statistics = 1u << 0;
+    inline constexpr unsigned compact_nodes = 1u << 1;
+    inline constexpr unsigned threaded = 1u << 2;
+
     namespace detail {
 
-        template <typename T>
+        // Пустые поля разных типов не обязаны иметь разные адреса, поэтому
+        // заглушка своя для каждого типа поля.
+        template <typename Field>
+        struct Empty {};
+
+        template <bool Enabled, typename Field>
+        using optional_field =
+            std::conditional_t<Enabled, Field, Empty<Field>>;
+
+        template <typename Node>
+        struct Thread {
+            Node* prev;
+            Node* next;
+        };
+
+        template <typename T, unsigned Options = 0>
         struct Node {
+            static constexpr bool compact = (Options & compact_nodes) != 0;
+
             T key;
-            bool color;
-            Node* parent;
+            [[no_unique_address]] optional_field<!compact, bool> color_;
+            std::conditional_t<compact, std::uintptr_t, Node*> parent_;
             Node* left;
             Node* right;
+            [[no_unique_address]] optional_field<
+                (Options & order_statistics) != 0,
+                std::size_t> size{};
+            [[no_unique_address]] optional_field<
+                (Options & threaded) != 0,
+                Thread<Node>> thread{};
 
             Node(
                 T key_,
-                bool color_ = RED,
-                Node* parent_ = 0,
+                bool color = RED,
+                Node* parent = 0,
                 Node* left_ = 0,
                 Node* right_ = 0)
-                : key(key_),
-                  color(color_),
-                  parent(parent_),
+                : key(std::move(key_)),
+                  color_(),
+                  parent_(),
                   left(left_),
-                  right(right_){};
+                  right(right_) {
+                set_color(color);
+                set_parent(parent);
+            }
+
+            // Ключ конструируется прямо в узле, без промежуточных копий.
+            template <typename... Args>
+            explicit Node(std::in_place_t, Args&&... args)
+                : key(std::forward<Args>(args)...),
+                  color_(),
+                  parent_(),
+                  left(0),
+                  right(0) {
+                set_color(RED);
+            }
+
+            bool color() const {
+                if constexpr (compact) {
+                    return (parent_ & 1) != 0;
+                } else {
+                    return color_;
+                }
+            }
+
+            void set_color(bool color) {
+                if constexpr (compact) {
+                    parent_ = (parent_ & ~std::uintptr_t(1)) | color;
+                } else {
+                    color_ = color;
+                }
+            }
+
+            Node* parent() const {
+                if constexpr (compact) {
+                    return reinterpret_cast<Node*>(
+                        parent_ & ~std::uintptr_t(1));
+                } else {
+                    return parent_;
+                }
+            }
+
+            void set_parent(Node* parent) {
+                if constexpr (compact) {
+                    parent_ = reinterpret_cast<std::uintptr_t>(parent) |
+                        (parent_ & 1);
+                } else {
+                    parent_ = parent;
+                }
+            }
 
             auto operator<=>(const Node& rhs) const {
                 return key <=> rhs.key;
@@ -40,40 +138,241 @@ namespace treeset {
                 return key == rhs.key;
             }
         };
+
+        // Компаратор с is_transparent разрешает поиск по ключам других
+        // типов без создания временного T.
+        template <typename Compare>
+        concept transparent = requires {
+            typename Compare::is_transparent;
+        };
+
+        // Компаратор может сам дать трёхстороннее сравнение методом
+        // compare(lhs, rhs); operator() при этом остаётся обязательным.
+        template <typename Compare, typename L, typename R>
+        concept compare_member = requires(
+            const Compare& comp,
+            const L& lhs,
+            const R& rhs) {
+            std::weak_ordering(comp.compare(lhs, rhs));
+        };
+
+        // 1 для std::less, -1 для std::greater: их порядок совпадает с
+        // operator<=> ключей (или обратен ему).
+        template <typename Compare, typename T>
+        inline constexpr int natural_order = 0;
+
+        template <typename T>
+        inline constexpr int natural_order<std::less<>, T> = 1;
+
+        template <typename T>
+        inline constexpr int natural_order<std::less<T>, T> = 1;
+
+        template <typename T>
+        inline constexpr int natural_order<std::greater<>, T> = -1;
+
+        template <typename T>
+        inline constexpr int natural_order<std::greater<T>, T> = -1;
+
+        template <typename Compare, typename T, typename L, typename R>
+        concept three_way_by = compare_member<Compare, L, R> ||
+            (natural_order<Compare, T> != 0 &&
+             std::three_way_comparable_with<L, R, std::weak_ordering>);
+
+        template <typename T, typename Compare, typename L, typename R>
+        std::weak_ordering compare_keys(
+            const Compare& comp,
+            const L& lhs,
+            const R& rhs) {
+            if constexpr (compare_member<Compare, L, R>) {
+                return comp.compare(lhs, rhs);
+            } else if constexpr (natural_order<Compare, T> > 0) {
+                return lhs <=> rhs;
+            } else {
+                return rhs <=> lhs;
+            }
+        }
+
+        // Ограничитель дерева — единственный узел, ссылающийся на себя.
+        template <typename Node>
+        bool is_null(const Node* node) {
+            return node->left == node;
+        }
+
+        // Позиция узла в порядке обхода и корень его дерева; используется
+        // при включённом order_statistics.
+        template <typename Node>
+        std::pair<std::size_t, Node*> rank_and_root(Node* node) {
+            auto rank = node->left->size;
+            for (auto parent = node->parent(); !is_null(parent);
+                 parent = node->parent()) {
+                if (node == parent->right) {
+                    rank += parent->left->size + 1;
+                }
+                node = parent;
+            }
+            return std::make_pair(rank, node);
+        }
+
+        template <typename Node>
+        Node* select(Node* node, Node* null_node, std::size_t index) {
+            while (node != null_node) {
+                auto left = node->left->size;
+                if (index < left) {
+                    node = node->left;
+                } else if (index == left) {
+                    return node;
+                } else {
+                    index -= left + 1;
+                    node = node->right;
+                }
+            }
+            return null_node;
+        }
+
+        // Копия диапазона, отсортированная по comp и без повторов; уже
+        // строго возрастающий диапазон только копируется.
+        template <typename T, typename It, typename Compare>
+        std::vector<T> sorted_unique(It first, It last, const Compare& comp) {
+            std::vector<T> keys(first, last);
+            auto less = [&comp](const T& lhs, const T& rhs) {
+                return comp(lhs, rhs);
+            };
+            if (std::adjacent_find(
+                    keys.begin(), keys.end(), std::not_fn(less)) !=
+                keys.end()) {
+                std::sort(keys.begin(), keys.end(), less);
+                keys.erase(
+                    std::unique(
+                        keys.begin(), keys.end(),
+                        [&less](const T& lhs, const T& rhs) {
+                            return !less(lhs, rhs);
+                        }),
+                    keys.end());
+            }
+            return keys;
+        }
     }  // namespace detail
 
+    // Определён в libset/frozen_set.hpp.
+    template <typename T, typename Compare, typename Allocator>
+    class FrozenSet;
+
+    // Операция пакета для Set::apply_batch.
     template <typename T>
+    struct BatchOp {
+        enum Kind { insert, erase };
+
+        Kind kind;
+        T key;
+    };
+
+    // Пара итераторов, пригодная для range-for.
+    template <typename Iterator>
+    class Range {
+       public:
+        Range(Iterator first, Iterator last) : first_(first), last_(last) {
+        }
+
+        Iterator begin() const {
+            return first_;
+        }
+
+        Iterator end() const {
+            return last_;
+        }
+
+        bool empty() const {
+            return first_ == last_;
+        }
+
+       private:
+        Iterator first_;
+        Iterator last_;
+    };
+
+    template <
+        typename T,
+        typename Compare = std::less<>,
+        typename Allocator = std::allocator<T>,
+        unsigned Options = 0>
     class Set {
        private:
-        detail::Node<T>* root;
-        detail::Node<T>* null_node;
-        detail::Node<T>** min_;
-        detail::Node<T>** max_;
+        static constexpr bool counted = (Options & order_statistics) != 0;
+        static constexpr bool linked = (Options & threaded) != 0;
+
+        using Node = detail::Node<T, Options>;
+        using node_allocator = typename std::allocator_traits<
+            Allocator>::template rebind_alloc<Node>;
+        using node_alloc_traits = std::allocator_traits<node_allocator>;
+
+        Node* root;
+        Node* null_node;
+        Node* min_;
         std::size_t size_;
+        [[no_unique_address]] Compare comp_;
+        detail::NodePool<Node, node_allocator> pool_;
+
+        // null_node служит и заголовком: его parent указывает на
+        // максимальный узел (на себя в пустом множестве), а left и right —
+        // на себя, по этой петле итератор и узнаёт конец.
+        Node* create_null_node() {
+            auto& alloc = pool_.get_allocator();
+            auto node = node_alloc_traits::allocate(alloc, 1);
+            node_alloc_traits::construct(alloc, node, T(), BLACK);
+            node->set_parent(node);
+            node->left = node;
+            node->right = node;
+            link(node, node);
+            return node;
+        }
+
+        void destroy_null_node() {
+            if (null_node) {
+                auto& alloc = pool_.get_allocator();
+                node_alloc_traits::destroy(alloc, null_node);
+                node_alloc_traits::deallocate(alloc, null_node, 1);
+                null_node = nullptr;
+            }
+        }
 
-        detail::Node<T>* min(detail::Node<T>* node) const {
+        Node* max_node() const {
+            return null_node->parent();
+        }
+
+        void set_max(Node* node) {
+            null_node->set_parent(node);
+        }
+
+        Node* min(Node* node) const {
             while (node->left != null_node) {
                 node = node->left;
             }
             return node;
         }
 
-        detail::Node<T>* grandparent(detail::Node<T>* node) const {
-            return node->parent->parent;
+        Node* max(Node* node) const {
+            while (node->right != null_node) {
+                node = node->right;
+            }
+            return node;
+        }
+
+        Node* grandparent(Node* node) const {
+            return node->parent()->parent();
         }
 
-        detail::Node<T>* uncle(detail::Node<T>* node) const {
+        Node* uncle(Node* node) const {
             auto grandpa = grandparent(node);
-            if (grandpa->left == node->parent) {
+            if (grandpa->left == node->parent()) {
                 return grandpa->right;
             } else {
                 return grandpa->left;
             }
         }
 
-        detail::Node<T>* second_child(
-            detail::Node<T>* parent,
-            detail::Node<T>* child) const {
+        Node* second_child(
+            Node* parent,
+            Node* child) const {
             if (parent->left == child) {
                 return parent->right;
             } else if (parent->right == child) {
@@ -83,110 +382,426 @@ namespace treeset {
             }
         }
 
-        void clear(detail::Node<T>* node) {
+        // Разрушает ключи поддерева; память узлов возвращается пулом.
+        // Без рекурсии: левый ребёнок поворотом поднимается наверх, узел
+        // без левого ребёнка разрушается, и обход идёт вправо.
+        void clear(Node* node) {
+            while (node != null_node) {
+                auto left = node->left;
+                if (left != null_node) {
+                    node->left = left->right;
+                    left->right = node;
+                    node = left;
+                } else {
+                    auto right = node->right;
+                    node_alloc_traits::destroy(pool_.get_allocator(), node);
+                    node = right;
+                }
+            }
+        }
+
+        // Поправка размеров поддеревьев на пути от node до корня.
+        void update_path(Node* node, int delta) {
+            while (node != null_node) {
+                node->size += delta;
+                node = node->parent();
+            }
+        }
+
+        // Число элементов, меньших ключа node.
+        std::size_t rank_of(Node* node) const {
             if (node == null_node) {
-                return;
+                return size_;
+            }
+            return detail::rank_and_root(node).first;
+        }
+
+        Node* successor(Node* node) const {
+            if (node->right != null_node) {
+                return min(node->right);
+            }
+            auto parent = node->parent();
+            while (parent != null_node && node == parent->right) {
+                node = parent;
+                parent = parent->parent();
+            }
+            return parent;
+        }
+
+        Node* predecessor(Node* node) const {
+            if (node->left != null_node) {
+                return max(node->left);
+            }
+            auto parent = node->parent();
+            while (parent != null_node && node == parent->left) {
+                node = parent;
+                parent = parent->parent();
+            }
+            return parent;
+        }
+
+        Node* prev_node(Node* node) const {
+            if constexpr (linked) {
+                return node->thread.prev;
+            } else {
+                return predecessor(node);
+            }
+        }
+
+        Node* next_node(Node* node) const {
+            if constexpr (linked) {
+                return node->thread.next;
+            } else {
+                return successor(node);
+            }
+        }
+
+        // Делает prev и next соседями в списке threaded; null_node
+        // замыкает список в кольцо.
+        static void link(Node* prev, Node* next) {
+            if constexpr (linked) {
+                prev->thread.next = next;
+                next->thread.prev = prev;
+            }
+        }
+
+        // Прошивает всё дерево заново после массовых операций.
+        void rethread() {
+            if constexpr (linked) {
+                auto prev = null_node;
+                for (auto node = min_; node != null_node;
+                     node = successor(node)) {
+                    link(prev, node);
+                    prev = node;
+                }
+                link(prev, null_node);
             }
-            clear(node->left);
-            clear(node->right);
-            --size_;
-            delete node;
-            node = null_node;
         }
 
-        detail::Node<T>* find(T key, detail::Node<T>* node) const {
+        template <typename K>
+        Node* lower_bound_node(const K& key) const {
+            auto node = root;
+            auto result = null_node;
             while (node != null_node) {
-                if (node->key < key) {
-                    if (node->right == null_node) {
-                        return node;
-                    }
+                if (comp_(node->key, key)) {
                     node = node->right;
-                } else if (node->key > key) {
-                    if (node->left == null_node) {
-                        return node;
-                    }
+                } else {
+                    result = node;
+                    node = node->left;
+                }
+            }
+            return result;
+        }
+
+        template <typename K>
+        Node* upper_bound_node(const K& key) const {
+            auto node = root;
+            auto result = null_node;
+            while (node != null_node) {
+                if (comp_(key, node->key)) {
+                    result = node;
                     node = node->left;
                 } else {
+                    node = node->right;
+                }
+            }
+            return result;
+        }
+
+        template <typename K>
+        std::size_t erase_key(const K& key) {
+            auto node = find_node(key);
+            if (node == null_node) {
+                return 0;
+            }
+            remove(node);
+            return 1;
+        }
+
+        // Порядок key относительно ключа node. Если политика сравнения
+        // позволяет, это один вызов <=> или Compare::compare на уровень,
+        // иначе до двух вызовов comp_.
+        template <typename K>
+        std::weak_ordering order(const K& key, const Node* node) const {
+            if constexpr (detail::three_way_by<Compare, T, K, T>) {
+                return detail::compare_keys<T>(comp_, key, node->key);
+            } else if (comp_(node->key, key)) {
+                return std::weak_ordering::greater;
+            } else if (comp_(key, node->key)) {
+                return std::weak_ordering::less;
+            } else {
+                return std::weak_ordering::equivalent;
+            }
+        }
+
+        template <typename K>
+        Node* find_node(const K& key) const {
+            auto node = root;
+            while (node != null_node) {
+                auto cmp = order(key, node);
+                if (cmp == 0) {
                     return node;
                 }
+                node = cmp < 0 ? node->left : node->right;
             }
             return null_node;
         }
 
-        void rotate_left(detail::Node<T>* node) {
+        // Один спуск от корня: возвращает узел с равным ключом (side == 0)
+        // либо будущего родителя и сторону вставки (-1 слева, 1 справа).
+        // Ключ больше максимума дописывается за ним без спуска.
+        template <typename K>
+        std::pair<Node*, int> insert_position(const K& key) const {
+            auto max = max_node();
+            if (max != null_node && order(key, max) > 0) {
+                return std::make_pair(max, 1);
+            }
+            return insert_position(key, root);
+        }
+
+        // Позиция для вставки рядом с hint: если key лежит между hint и
+        // его соседом, спуска нет, иначе — обычный спуск от корня.
+        template <typename K>
+        std::pair<Node*, int> insert_position_near(
+            const K& key,
+            Node* hint) const {
+            if (size_ == 0) {
+                return std::make_pair(null_node, 0);
+            }
+            if (hint == null_node) {
+                // вставка перед end(): кандидат — место за максимумом
+                return insert_position(key);
+            }
+            auto cmp = order(key, hint);
+            if (cmp == 0) {
+                return std::make_pair(hint, 0);
+            }
+            if (cmp < 0) {
+                if (hint == min_) {
+                    return std::make_pair(hint, -1);
+                }
+                auto prev = prev_node(hint);
+                if (order(key, prev) > 0) {
+                    return hint->left == null_node
+                        ? std::make_pair(hint, -1)
+                        : std::make_pair(prev, 1);
+                }
+            } else {
+                auto next = next_node(hint);
+                if (next == null_node || order(key, next) < 0) {
+                    return hint->right == null_node
+                        ? std::make_pair(hint, 1)
+                        : std::make_pair(next, -1);
+                }
+            }
+            return insert_position(key, root);
+        }
+
+        // То же, но спуск начинается с поддерева from, в диапазон
+        // которого попадает key.
+        template <typename K>
+        std::pair<Node*, int> insert_position(
+            const K& key,
+            Node* from) const {
+            auto node = from;
+            auto parent = null_node;
+            int side = 0;
+            while (node != null_node) {
+                parent = node;
+                auto cmp = order(key, node);
+                if (cmp == 0) {
+                    return std::make_pair(node, 0);
+                }
+                side = cmp < 0 ? -1 : 1;
+                node = cmp < 0 ? node->left : node->right;
+            }
+            return std::make_pair(parent, side);
+        }
+
+        // finger — узел с ключом меньше key. Поднимается от него до
+        // ближайшего поддерева, в диапазон которого попадает key: для
+        // возрастающих ключей спуск с него короче спуска от корня.
+        template <typename K>
+        Node* climb(Node* finger, const K& key) const {
+            if (finger == null_node) {
+                return root;
+            }
+            while (finger != root) {
+                auto parent = finger->parent();
+                if (finger == parent->left && comp_(key, parent->key)) {
+                    break;
+                }
+                finger = parent;
+            }
+            return finger;
+        }
+
+        // Применяет операции по строго возрастающим ключам: каждый спуск
+        // начинается от места предыдущей операции. Ребалансировка
+        // остаётся локальной — O(1) поворотов на операцию в среднем.
+        template <typename It, typename Erase>
+        void apply_sorted(It first, It last, Erase erase) {
+            auto finger = null_node;
+            for (; first != last; ++first) {
+                auto&& key = *first;
+                auto [pos, side] = insert_position(key, climb(finger, key));
+                bool found = side == 0 && pos != null_node;
+                if (!erase(key)) {
+                    if (!found) {
+                        auto node = pool_.create(
+                            std::in_place, std::forward<decltype(key)>(key));
+                        attach(pos, side, node);
+                        pos = node;
+                    }
+                    finger = pos;
+                } else if (found) {
+                    finger = prev_node(pos);
+                    remove(pos);
+                }
+            }
+        }
+
+        template <typename K>
+        Node* insert_hinted(Node* hint, K&& key) {
+            auto [pos, side] = insert_position_near(key, hint);
+            if (side == 0 && pos != null_node) {
+                return pos;
+            }
+            auto node = pool_.create(std::in_place, std::forward<K>(key));
+            attach(pos, side, node);
+            return node;
+        }
+
+        void attach(
+            Node* parent,
+            int side,
+            Node* node) {
+            node->set_parent(parent);
+            node->left = null_node;
+            node->right = null_node;
+            ++size_;
+            if constexpr (counted) {
+                node->size = 1;
+                update_path(parent, 1);
+            }
+            if constexpr (linked) {
+                if (parent == null_node) {
+                    link(null_node, node);
+                    link(node, null_node);
+                } else if (side < 0) {
+                    link(parent->thread.prev, node);
+                    link(node, parent);
+                } else {
+                    link(node, parent->thread.next);
+                    link(parent, node);
+                }
+            }
+            if (parent == null_node) {
+                node->set_color(BLACK);
+                root = node;
+                min_ = node;
+                set_max(node);
+                return;
+            }
+            node->set_color(RED);
+            if (side < 0) {
+                parent->left = node;
+                if (parent == min_) {
+                    min_ = node;
+                }
+            } else {
+                parent->right = node;
+                if (parent == max_node()) {
+                    set_max(node);
+                }
+            }
+            add_autobalance(node);
+            raise_root();
+        }
+
+        // Повороты не трогают root: корнем считается узел без родителя,
+        // поэтому балансировка работает и на отдельных поддеревьях.
+        void raise_root() {
+            while (root->parent() != null_node) {
+                root = root->parent();
+            }
+        }
+
+        void rotate_left(Node* node) {
             auto right = node->right;
             if (node == null_node || right == null_node) {
                 return;
             }
             node->right = right->left;
             if (right->left != null_node) {
-                right->left->parent = node;
+                right->left->set_parent(node);
             }
 
             right->left = node;
-            right->parent = node->parent;
-            if (right->left->key == (*min_)->key) {
-                min_ = &right->left;
+            right->set_parent(node->parent());
+            node->set_parent(right);
+            if constexpr (counted) {
+                right->size = node->size;
+                node->size = node->left->size + node->right->size + 1;
             }
-            node->parent = right;
 
-            if (right->parent != null_node) {
-                if (right->parent->right == node) {
-                    right->parent->right = right;
+            if (right->parent() != null_node) {
+                if (right->parent()->right == node) {
+                    right->parent()->right = right;
                 } else {
-                    right->parent->left = right;
+                    right->parent()->left = right;
                 }
-            } else {
-                root = right;
             }
         }
 
-        void rotate_right(detail::Node<T>* root) {
+        void rotate_right(Node* root) {
             auto left = root->left;
             if (root == null_node || left == null_node) {
                 return;
             }
             root->left = left->right;
             if (left->right != null_node) {
-                left->right->parent = root;
+                left->right->set_parent(root);
             }
 
             left->right = root;
-            left->parent = root->parent;
-            if (left->right->key == (*max_)->key) {
-                max_ = &left->right;
+            left->set_parent(root->parent());
+            root->set_parent(left);
+            if constexpr (counted) {
+                left->size = root->size;
+                root->size = root->left->size + root->right->size + 1;
             }
-            root->parent = left;
 
-            if (left->parent != null_node) {
-                if (left->parent->right == root) {
-                    left->parent->right = left;
+            if (left->parent() != null_node) {
+                if (left->parent()->right == root) {
+                    left->parent()->right = left;
                 } else {
-                    left->parent->left = left;
+                    left->parent()->left = left;
                 }
-            } else {
-                this->root = left;
             }
         }
 
-        void add_autobalance(detail::Node<T>* node) {
+        // Возвращает true, если перекрашивание дошло до корня и черная
+        // высота дерева выросла на единицу.
+        bool add_autobalance(Node* node) {
             if (node) {
-                if (node == this->root) {
-                    node->color = BLACK;
-                    return;
+                if (node->parent() == null_node) {
+                    bool grew = node->color() == RED;
+                    node->set_color(BLACK);
+                    return grew;
                 }
-                auto parent = node->parent;
-                if (parent->color == BLACK) {
-                    return;
+                auto parent = node->parent();
+                if (parent->color() == BLACK) {
+                    return false;
                 } else {
                     auto unc = uncle(node);
                     auto grandpa = grandparent(node);
 
-                    if (unc->color == RED) {
-                        unc->color = BLACK;
-                        parent->color = BLACK;
-                        grandpa->color = RED;
-                        add_autobalance(grandpa);
+                    if (unc->color() == RED) {
+                        unc->set_color(BLACK);
+                        parent->set_color(BLACK);
+                        grandpa->set_color(RED);
+                        return add_autobalance(grandpa);
                     } else {
                         if (parent->right == node && grandpa->left == parent) {
                             rotate_left(parent);
@@ -197,11 +812,11 @@ namespace treeset {
                             node = node->right;
                         }
 
-                        parent = node->parent;
-                        grandpa = parent->parent;
+                        parent = node->parent();
+                        grandpa = parent->parent();
 
-                        parent->color = BLACK;
-                        grandpa->color = RED;
+                        parent->set_color(BLACK);
+                        grandpa->set_color(RED);
 
                         if (parent->left == node && grandpa->left == parent) {
                             rotate_right(grandpa);
@@ -212,17 +827,18 @@ namespace treeset {
                     }
                 }
             }
+            return false;
         }
 
-        void rem_autobalance(detail::Node<T>* parent, detail::Node<T>* node) {
+        void rem_autobalance(Node* parent, Node* node) {
             if (parent == null_node) {
                 return;
             }
 
             auto brother = second_child(parent, node);
-            if (brother->color == RED) {
-                parent->color = RED;
-                brother->color = BLACK;
+            if (brother->color() == RED) {
+                parent->set_color(RED);
+                brother->set_color(BLACK);
                 if (node == parent->right) {
                     rotate_right(parent);
                 } else {
@@ -231,269 +847,1114 @@ namespace treeset {
             }
 
             brother = second_child(parent, node);
-            if (brother->color == BLACK &&
-                brother->left->color == brother->right->color &&
-                brother->left->color == BLACK && parent->color == BLACK) {
-                brother->color = RED;
-                rem_autobalance(parent->parent, parent);
+            if (brother->color() == BLACK &&
+                brother->left->color() == brother->right->color() &&
+                brother->left->color() == BLACK && parent->color() == BLACK) {
+                brother->set_color(RED);
+                rem_autobalance(parent->parent(), parent);
                 return;
             }
 
             brother = second_child(parent, node);
-            if (brother->color == BLACK &&
-                brother->left->color == brother->right->color &&
-                brother->left->color == BLACK && parent->color == RED) {
-                brother->color = RED;
-                parent->color = BLACK;
+            if (brother->color() == BLACK &&
+                brother->left->color() == brother->right->color() &&
+                brother->left->color() == BLACK && parent->color() == RED) {
+                brother->set_color(RED);
+                parent->set_color(BLACK);
                 return;
             }
 
             brother = second_child(parent, node);
-            if (brother->color == BLACK) {
-                if (node == parent->left && brother->right->color == BLACK &&
-                    brother->left->color == RED) {
-                    brother->color = RED;
-                    brother->left->color = BLACK;
+            if (brother->color() == BLACK) {
+                if (node == parent->left && brother->right->color() == BLACK &&
+                    brother->left->color() == RED) {
+                    brother->set_color(RED);
+                    brother->left->set_color(BLACK);
                     rotate_right(brother);
                 } else if (
-                    node == parent->right && brother->left->color == BLACK &&
-                    brother->left->color == RED) {
-                    brother->color = RED;
-                    brother->right->color = BLACK;
+                    node == parent->right && brother->left->color() == BLACK &&
+                    brother->right->color() == RED) {
+                    brother->set_color(RED);
+                    brother->right->set_color(BLACK);
                     rotate_left(brother);
                 }
             }
 
             brother = second_child(parent, node);
-            brother->color = parent->color;
-            parent->color = BLACK;
+            brother->set_color(parent->color());
+            parent->set_color(BLACK);
 
             if (node == parent->left) {
-                brother->right->color = BLACK;
+                brother->right->set_color(BLACK);
                 rotate_left(parent);
             } else {
-                brother->left->color = BLACK;
+                brother->left->set_color(BLACK);
                 rotate_right(parent);
             }
         }
 
-        bool remove(T key, detail::Node<T>* root) {
-            auto node = find(key, root);
-            if (node && node->key == key) {
-                if (node->left != null_node && node->right != null_node) {
-                    auto tmp = min(node->right);
-                    node->key = tmp->key;
-                    return remove(tmp->key, tmp);
-                } else if (node->left != null_node) {
-                    auto parent = node->parent;
-                    if (parent->left == node) {
-                        parent->left = node->left;
-                    } else if (parent->right == node) {
-                        parent->right = node->left;
-                    }
-                    node->left->parent = parent;
-                    if (parent == null_node) {
-                        this->root = node->left;
-                    }
-                    if (node->color == BLACK) {
-                        if (node->left->color == RED) {
-                            node->left->color = BLACK;
-                        } else {
-                            rem_autobalance(parent, node->left);
-                        }
-                    }
-                    delete node;
-                    --size_;
-                    return true;
+        // Ставит replacement на место node в родителе node.
+        void transplant(Node* node, Node* replacement) {
+            auto parent = node->parent();
+            if (parent == null_node) {
+                root = replacement;
+            } else if (parent->left == node) {
+                parent->left = replacement;
+            } else {
+                parent->right = replacement;
+            }
+            if (replacement != null_node) {
+                replacement->set_parent(parent);
+            }
+        }
+
+        // Удаляет узел и возвращает узел со следующим по порядку ключом.
+        // Ключи не перемещаются: при двух детях на место node
+        // перевешивается сам узел-преемник, так что итераторы на
+        // остальные элементы остаются действительными.
+        Node* remove(Node* node) {
+            auto next = next_node(node);
+            // новые крайние — соседи удаляемого, второго спуска не нужно
+            if (node == min_) {
+                min_ = next;
+            }
+            if (node == max_node()) {
+                set_max(prev_node(node));
+            }
+
+            Node* child;
+            Node* parent;
+            bool color = node->color();
+            if (node->left == null_node || node->right == null_node) {
+                child = node->left != null_node ? node->left : node->right;
+                parent = node->parent();
+                transplant(node, child);
+            } else {
+                // next == min(node->right), левого ребёнка у него нет
+                color = next->color();
+                child = next->right;
+                if (next->parent() == node) {
+                    parent = next;
                 } else {
-                    auto parent = node->parent;
-                    if (parent->left == node) {
-                        parent->left = node->right;
-                    } else if (parent->right == node) {
-                        parent->right = node->right;
-                    }
-                    if (node->right != null_node) {
-                        node->right->parent = parent;
-                    }
-                    if (parent == null_node) {
-                        root = node->right;
+                    parent = next->parent();
+                    parent->left = child;
+                    if (child != null_node) {
+                        child->set_parent(parent);
                     }
+                    next->right = node->right;
+                    next->right->set_parent(next);
+                }
+                transplant(node, next);
+                next->left = node->left;
+                next->left->set_parent(next);
+                next->set_color(node->color());
+                next->size = node->size;
+            }
+            if constexpr (counted) {
+                update_path(parent, -1);
+            }
 
-                    if (node->color == BLACK) {
-                        if (node->right->color == RED) {
-                            node->right->color = BLACK;
-                        } else {
-                            rem_autobalance(parent, node->right);
-                        }
-                    }
-                    delete node;
-                    --size_;
-                    return true;
+            if (color == BLACK) {
+                if (child->color() == RED) {
+                    child->set_color(BLACK);
+                } else {
+                    rem_autobalance(parent, child);
+                    raise_root();
                 }
             }
-            return false;
+            if constexpr (linked) {
+                link(node->thread.prev, node->thread.next);
+            }
+            pool_.destroy(node);
+            --size_;
+            return next;
         }
 
-        void copy_nodes(
-            detail::Node<T>** newNode,
-            const detail::Node<T>* oldNode,
-            detail::Node<T>** parent,
-            const Set<T>& other) {
-            if (oldNode == other.null_node) {
-                *newNode = null_node;
+        // Копирует дерево other с той же формой и цветами. Все узлы
+        // выделяются одним блоком и заполняются в прямом порядке обхода;
+        // обход идёт по ссылкам на родителя, без рекурсии и стека.
+        void copy_nodes(const Set& other) {
+            if (other.size_ == 0) {
                 return;
             }
-
-            *newNode =
-                new detail::Node<T>(oldNode->key, oldNode->color, *parent);
-            size_++;
-
-            copy_nodes(&(*newNode)->left, oldNode->left, newNode, other);
-            copy_nodes(&(*newNode)->right, oldNode->right, newNode, other);
-            if (oldNode->left == *(other.min_)) {
-                min_ = &(*newNode)->left;
-            }
-            if (oldNode->right == *(other.max_)) {
-                max_ = &(*newNode)->right;
+            auto slot = pool_.allocate_batch(other.size_);
+            auto copy = [&](const Node* from, Node* parent) {
+                auto node = slot++;
+                pool_.construct(node, from->key, from->color(), parent);
+                node->size = from->size;
+                if (from == other.min_) {
+                    min_ = node;
+                }
+                if (from == other.max_node()) {
+                    set_max(node);
+                }
+                return node;
+            };
+
+            const Node* from = other.root;
+            Node* to = copy(from, null_node);
+            root = to;
+            // у ещё не скопированного ребёнка указатель пока нулевой
+            while (from != other.null_node) {
+                if (!to->left) {
+                    if (from->left != other.null_node) {
+                        to->left = copy(from->left, to);
+                        from = from->left;
+                        to = to->left;
+                        continue;
+                    }
+                    to->left = null_node;
+                }
+                if (!to->right) {
+                    if (from->right != other.null_node) {
+                        to->right = copy(from->right, to);
+                        from = from->right;
+                        to = to->right;
+                        continue;
+                    }
+                    to->right = null_node;
+                }
+                from = from->parent();
+                to = to->parent();
             }
+            size_ = other.size_;
         }
 
-        void print_tree(detail::Node<T>* root, std::string path) const {
-            if (root == null_node) {
+        void steal(Set& other) {
+            root = other.root;
+            null_node = other.null_node;
+            min_ = other.min_;
+            size_ = other.size_;
+            other.root = nullptr;
+            other.null_node = nullptr;
+            other.min_ = nullptr;
+            other.size_ = 0;
+        }
+
+        // Строит идеально сбалансированное дерево из n упорядоченных
+        // ключей за O(n). Узлы создаются в порядке обхода, поэтому лежат в
+        // пуле подряд; красным красится только нижний неполный уровень.
+        template <typename It>
+        void build_sorted(It first, std::size_t n) {
+            if (n == 0) {
                 return;
             }
-            print_tree(root->left, path + "l");
-            std::cout << root->key << " " << path << std::endl;
-            print_tree(root->right, path + "r");
+            pool_.reserve(n);
+            set_built(build_subtree(first, n, 0, red_depth(n)), n);
         }
 
-       public:
-        Set()
-            : root(nullptr),
-              null_node(new detail::Node<T>(0, BLACK)),
-              min_(nullptr),
-              max_(nullptr),
-              size_(0) {
-            null_node->parent = null_node;
-            null_node->left = null_node;
-            null_node->right = null_node;
-            root = null_node;
-            min_ = &null_node;
-            max_ = &null_node;
+        static std::size_t red_depth(std::size_t n) {
+            return std::size_t(std::bit_width(n) - 1);
+        }
+
+        void set_built(Node* top, std::size_t n) {
+            root = top;
+            root->set_parent(null_node);
+            size_ = n;
+            min_ = min(root);
+            set_max(max(root));
+            rethread();
+        }
+
+        template <typename It>
+        Node* build_subtree(
+            It& first,
+            std::size_t n,
+            std::size_t depth,
+            std::size_t red_depth) {
+            if (n == 0) {
+                return null_node;
+            }
+            auto left_size = (n - 1) / 2;
+            auto left = build_subtree(first, left_size, depth + 1, red_depth);
+            auto node = pool_.create(std::in_place, *first);
+            ++first;
+            node->set_color(depth == red_depth && depth > 0 ? RED : BLACK);
+            auto right =
+                build_subtree(first, n - left_size - 1, depth + 1, red_depth);
+            link_children(node, left, right);
+            return node;
+        }
+
+        // То же разбиение, что у build_subtree, но i-й по порядку ключ
+        // кладется в slots[i].
+        template <typename It>
+        Node* build_slots(
+            It first,
+            Node* slots,
+            std::size_t n,
+            std::size_t depth,
+            std::size_t red_depth) {
+            if (n == 0) {
+                return null_node;
+            }
+            auto left_size = (n - 1) / 2;
+            auto middle = first + std::iter_difference_t<It>(left_size);
+            auto node = slots + left_size;
+            auto left =
+                build_slots(first, slots, left_size, depth + 1, red_depth);
+            pool_.construct(node, std::in_place, *middle);
+            node->set_color(depth == red_depth && depth > 0 ? RED : BLACK);
+            auto right = build_slots(
+                middle + 1, node + 1, n - left_size - 1, depth + 1, red_depth);
+            link_children(node, left, right);
+            return node;
+        }
+
+        // Половины больше policy.grain строятся параллельно.
+        template <typename It>
+        Node* build_parallel(
+            It first,
+            Node* slots,
+            std::size_t n,
+            std::size_t depth,
+            std::size_t red_depth,
+            const Parallel& policy) {
+            if (n == 0 || n < policy.grain) {
+                return build_slots(first, slots, n, depth, red_depth);
+            }
+            auto left_size = (n - 1) / 2;
+            auto middle = first + std::iter_difference_t<It>(left_size);
+            auto node = slots + left_size;
+            Node* left = null_node;
+            Node* right = null_node;
+            auto build_left = [&] {
+                left = build_parallel(
+                    first, slots, left_size, depth + 1, red_depth, policy);
+            };
+            auto build_right = [&] {
+                pool_.construct(node, std::in_place, *middle);
+                node->set_color(depth == red_depth && depth > 0 ? RED : BLACK);
+                right = build_parallel(
+                    middle + 1, node + 1, n - left_size - 1, depth + 1,
+                    red_depth, policy);
+            };
+            policy.threads().invoke(build_left, build_right);
+            link_children(node, left, right);
+            return node;
+        }
+
+        // Оценка числа узлов поддерева с черной высотой height снизу.
+        std::size_t estimated_size(Node* node, std::size_t height) const {
+            if constexpr (counted) {
+                return node->size;
+            } else {
+                return height < 64 ? std::size_t(1) << height : SIZE_MAX;
+            }
+        }
+
+        // Обход в порядке возрастания; ключи отдаются как const T&.
+        template <typename F>
+        void visit(Node* node, F& f) const {
+            if (node != null_node) {
+                visit(node->left, f);
+                f(std::as_const(node->key));
+                visit(node->right, f);
+            }
+        }
+
+        template <typename F>
+        void visit_parallel(
+            Node* node,
+            std::size_t height,
+            F& f,
+            const Parallel& policy) const {
+            if (node == null_node ||
+                estimated_size(node, height) < policy.grain) {
+                visit(node, f);
+                return;
+            }
+            height -= node->color() == BLACK ? 1 : 0;
+            policy.threads().invoke(
+                [&] { visit_parallel(node->left, height, f, policy); },
+                [&] {
+                    f(std::as_const(node->key));
+                    visit_parallel(node->right, height, f, policy);
+                });
+        }
+
+        template <typename R, typename Reduce, typename Transform>
+        void accumulate(
+            Node* node,
+            R& result,
+            Reduce& reduce,
+            Transform& transform) const {
+            if (node != null_node) {
+                accumulate(node->left, result, reduce, transform);
+                result = reduce(
+                    std::move(result), transform(std::as_const(node->key)));
+                accumulate(node->right, result, reduce, transform);
+            }
+        }
+
+        template <typename R, typename Reduce, typename Transform>
+        R reduce_parallel(
+            Node* node,
+            std::size_t height,
+            const R& identity,
+            Reduce& reduce,
+            Transform& transform,
+            const Parallel& policy) const {
+            R left = identity;
+            if (node == null_node ||
+                estimated_size(node, height) < policy.grain) {
+                accumulate(node, left, reduce, transform);
+                return left;
+            }
+            R right = identity;
+            height -= node->color() == BLACK ? 1 : 0;
+            policy.threads().invoke(
+                [&] {
+                    left = reduce_parallel(
+                        node->left, height, identity, reduce, transform,
+                        policy);
+                },
+                [&] {
+                    right = reduce_parallel(
+                        node->right, height, identity, reduce, transform,
+                        policy);
+                });
+            left = reduce(std::move(left), transform(std::as_const(node->key)));
+            return reduce(std::move(left), std::move(right));
+        }
+
+        // Отдельное поддерево с черным корнем и известной черной высотой
+        // (число черных узлов на пути до листа, включая корень).
+        struct Subtree {
+            Node* root;
+            std::size_t height;
         };
 
-        Set(T key)
-            : root(new detail::Node<T>(key, BLACK)),
-              null_node(new detail::Node<T>(0, BLACK)),
-              min_(&root),
-              max_(&root),
-              size_(1) {
-            null_node->parent = null_node;
-            null_node->left = null_node;
-            null_node->right = null_node;
-            root->left = null_node;
-            root->right = null_node;
-            root->parent = null_node;
+        struct Parts {
+            Subtree left;
+            Node* match;
+            Subtree right;
         };
 
-        Set(std::initializer_list<T> list)
+        std::size_t black_height(Node* node) const {
+            std::size_t height = 0;
+            for (; node != null_node; node = node->left) {
+                height += node->color() == BLACK ? 1 : 0;
+            }
+            return height;
+        }
+
+        // Отрезает ребенка узла с черной высотой height в отдельное дерево.
+        Subtree detach(Node* child, Node* node, std::size_t height) {
+            height -= node->color() == BLACK ? 1 : 0;
+            if (child != null_node) {
+                child->set_parent(null_node);
+                if (child->color() == RED) {
+                    child->set_color(BLACK);
+                    ++height;
+                }
+            }
+            return Subtree{child, height};
+        }
+
+        // Соединяет left < key < right. Спуск идет по краю более высокого
+        // дерева до узла той же черной высоты, затем работает обычная
+        // балансировка после вставки.
+        Subtree join(Subtree left, Node* key, Subtree right) {
+            if (left.height == right.height) {
+                key->set_color(BLACK);
+                key->set_parent(null_node);
+                link_children(key, left.root, right.root);
+                return Subtree{key, left.height + 1};
+            }
+
+            bool left_taller = left.height > right.height;
+            auto taller = left_taller ? left : right;
+            auto shorter = left_taller ? right : left;
+            auto node = taller.root;
+            auto height = taller.height;
+            auto parent = null_node;
+            while (node->color() == RED || height > shorter.height) {
+                if constexpr (counted) {
+                    node->size += shorter.root->size + 1;
+                }
+                height -= node->color() == BLACK ? 1 : 0;
+                parent = node;
+                node = left_taller ? node->right : node->left;
+            }
+
+            key->set_color(RED);
+            key->set_parent(parent);
+            if (left_taller) {
+                parent->right = key;
+                link_children(key, node, right.root);
+            } else {
+                parent->left = key;
+                link_children(key, left.root, node);
+            }
+
+            bool grew = add_autobalance(key);
+            auto top = taller.root;
+            while (top->parent() != null_node) {
+                top = top->parent();
+            }
+            return Subtree{top, taller.height + (grew ? 1 : 0)};
+        }
+
+        void link_children(Node* node, Node* left, Node* right) {
+            node->left = left;
+            node->right = right;
+            if (left != null_node) {
+                left->set_parent(node);
+            }
+            if (right != null_node) {
+                right->set_parent(node);
+            }
+            if constexpr (counted) {
+                node->size = left->size + right->size + 1;
+            }
+        }
+
+        template <typename K>
+        Parts split(Subtree tree, const K& key) {
+            if (tree.root == null_node) {
+                return Parts{tree, null_node, tree};
+            }
+            auto node = tree.root;
+            auto left = detach(node->left, node, tree.height);
+            auto right = detach(node->right, node, tree.height);
+            if (comp_(key, node->key)) {
+                auto parts = split(left, key);
+                parts.right = join(parts.right, node, right);
+                return parts;
+            }
+            if (comp_(node->key, key)) {
+                auto parts = split(right, key);
+                parts.left = join(left, node, parts.left);
+                return parts;
+            }
+            return Parts{left, node, right};
+        }
+
+        std::pair<Subtree, Node*> split_last(Subtree tree) {
+            auto node = tree.root;
+            auto left = detach(node->left, node, tree.height);
+            auto right = detach(node->right, node, tree.height);
+            if (right.root == null_node) {
+                return std::make_pair(left, node);
+            }
+            auto [rest, last] = split_last(right);
+            return std::make_pair(join(left, node, rest), last);
+        }
+
+        Subtree join(Subtree left, Subtree right) {
+            if (left.root == null_node) {
+                return right;
+            }
+            auto [rest, last] = split_last(left);
+            return join(rest, last, right);
+        }
+
+        // Контекст операции над двумя деревьями решает, откуда берутся
+        // узлы второго множества (свои при Owned — пул уже забран, иначе
+        // копии) и куда уходят удаленные, и можно ли запускать ветки
+        // рекурсии параллельно.
+        template <bool Owned>
+        struct Serial {
+            static constexpr bool owned = Owned;
+
+            Set& set;
+
+            Node* take(Node* node) {
+                ++set.size_;
+                if constexpr (Owned) {
+                    return node;
+                } else {
+                    return set.pool_.create(std::in_place, node->key);
+                }
+            }
+
+            void drop(Node* node) {
+                set.pool_.destroy(node);
+                --set.size_;
+            }
+
+            void discard(Node* node) {
+                if constexpr (Owned) {
+                    set.pool_.destroy(node);
+                }
+            }
+
+            template <typename F, typename G>
+            void fork(Subtree, Node*, F&& f, G&& g) {
+                f(*this);
+                g(*this);
+            }
+        };
+
+        // Слоты под копии ключей, выделенные до начала параллельной
+        // операции: пул узлов не потокобезопасен.
+        struct Batch {
+            Node* slots;
+            std::atomic<std::size_t> used;
+        };
+
+        // Каждая параллельная ветка получает свой контекст; удаленные узлы
+        // и изменение размера сливаются в родительский после join.
+        template <bool Owned>
+        struct Concurrent {
+            static constexpr bool owned = Owned;
+
+            Set& set;
+            Batch& batch;
+            const Parallel& policy;
+            std::size_t other_size;
+            std::size_t depth;
+            bool serial;
+            std::ptrdiff_t delta;
+            std::vector<Node*> garbage;
+
+            Concurrent(
+                Set& set_,
+                Batch& batch_,
+                const Parallel& policy_,
+                std::size_t other_size_,
+                std::size_t depth_ = 0)
+                : set(set_),
+                  batch(batch_),
+                  policy(policy_),
+                  other_size(other_size_),
+                  depth(depth_),
+                  serial(false),
+                  delta(0) {
+            }
+
+            Node* take(Node* node) {
+                ++delta;
+                if constexpr (Owned) {
+                    return node;
+                } else {
+                    auto slot = batch.slots +
+                        batch.used.fetch_add(1, std::memory_order_relaxed);
+                    set.pool_.construct(slot, std::in_place, node->key);
+                    return slot;
+                }
+            }
+
+            void drop(Node* node) {
+                set.pool_.destroy_value(node);
+                garbage.push_back(node);
+                --delta;
+            }
+
+            void discard(Node* node) {
+                if constexpr (Owned) {
+                    set.pool_.destroy_value(node);
+                    garbage.push_back(node);
+                }
+            }
+
+            // Объем работы: размер части первого дерева плюс размер
+            // поддерева other, оцененный по глубине рекурсии.
+            std::size_t work(Subtree tree, Node* other) const {
+                if constexpr (counted) {
+                    return tree.root->size + other->size;
+                } else {
+                    return set.estimated_size(tree.root, tree.height) +
+                        (depth < 64 ? other_size >> depth : 0);
+                }
+            }
+
+            template <typename F, typename G>
+            void fork(Subtree tree, Node* other, F&& f, G&& g) {
+                if (serial || work(tree, other) < policy.grain) {
+                    bool was_serial = serial;
+                    serial = true;
+                    f(*this);
+                    g(*this);
+                    serial = was_serial;
+                    return;
+                }
+                Concurrent child(set, batch, policy, other_size, depth + 1);
+                ++depth;
+                policy.threads().invoke(
+                    [&] { f(child); }, [&] { g(*this); });
+                --depth;
+                delta += child.delta;
+                garbage.insert(
+                    garbage.end(), child.garbage.begin(), child.garbage.end());
+            }
+        };
+
+        template <typename Context>
+        void drop_subtree(Node* node, Context& context) {
+            if (node != null_node) {
+                drop_subtree(node->left, context);
+                drop_subtree(node->right, context);
+                context.drop(node);
+            }
+        }
+
+        template <typename Context>
+        void release_other(
+            Node* node,
+            const Node* other_null,
+            Context& context) {
+            if constexpr (Context::owned) {
+                if (node != other_null) {
+                    release_other(node->left, other_null, context);
+                    release_other(node->right, other_null, context);
+                    context.discard(node);
+                }
+            }
+        }
+
+        template <typename Context>
+        Subtree unite(
+            Subtree tree,
+            Node* other,
+            const Node* other_null,
+            Context& context) {
+            if (other == other_null) {
+                return tree;
+            }
+            auto other_left = other->left;
+            auto other_right = other->right;
+            auto parts = split(tree, other->key);
+            Subtree left{};
+            Subtree right{};
+            context.fork(
+                tree, other,
+                [&](Context& branch) {
+                    left = unite(parts.left, other_left, other_null, branch);
+                },
+                [&](Context& branch) {
+                    right =
+                        unite(parts.right, other_right, other_null, branch);
+                });
+            auto node = parts.match;
+            if (node == null_node) {
+                node = context.take(other);
+            } else {
+                context.discard(other);
+            }
+            return join(left, node, right);
+        }
+
+        template <typename Context>
+        Subtree intersect(
+            Subtree tree,
+            Node* other,
+            const Node* other_null,
+            Context& context) {
+            if (other == other_null) {
+                drop_subtree(tree.root, context);
+                return Subtree{null_node, 0};
+            }
+            if (tree.root == null_node) {
+                release_other(other, other_null, context);
+                return tree;
+            }
+            auto other_left = other->left;
+            auto other_right = other->right;
+            auto parts = split(tree, other->key);
+            Subtree left{};
+            Subtree right{};
+            context.fork(
+                tree, other,
+                [&](Context& branch) {
+                    left =
+                        intersect(parts.left, other_left, other_null, branch);
+                },
+                [&](Context& branch) {
+                    right = intersect(
+                        parts.right, other_right, other_null, branch);
+                });
+            context.discard(other);
+            if (parts.match != null_node) {
+                return join(left, parts.match, right);
+            }
+            return join(left, right);
+        }
+
+        template <typename Context>
+        Subtree subtract(
+            Subtree tree,
+            Node* other,
+            const Node* other_null,
+            Context& context) {
+            if (other == other_null) {
+                return tree;
+            }
+            if (tree.root == null_node) {
+                release_other(other, other_null, context);
+                return tree;
+            }
+            auto other_left = other->left;
+            auto other_right = other->right;
+            auto parts = split(tree, other->key);
+            Subtree left{};
+            Subtree right{};
+            context.fork(
+                tree, other,
+                [&](Context& branch) {
+                    left =
+                        subtract(parts.left, other_left, other_null, branch);
+                },
+                [&](Context& branch) {
+                    right = subtract(
+                        parts.right, other_right, other_null, branch);
+                });
+            context.discard(other);
+            if (parts.match != null_node) {
+                context.drop(parts.match);
+            }
+            return join(left, right);
+        }
+
+        template <typename Context>
+        Subtree symmetric_subtract(
+            Subtree tree,
+            Node* other,
+            const Node* other_null,
+            Context& context) {
+            if (other == other_null) {
+                return tree;
+            }
+            auto other_left = other->left;
+            auto other_right = other->right;
+            auto parts = split(tree, other->key);
+            Subtree left{};
+            Subtree right{};
+            context.fork(
+                tree, other,
+                [&](Context& branch) {
+                    left = symmetric_subtract(
+                        parts.left, other_left, other_null, branch);
+                },
+                [&](Context& branch) {
+                    right = symmetric_subtract(
+                        parts.right, other_right, other_null, branch);
+                });
+            if (parts.match != null_node) {
+                context.drop(parts.match);
+                context.discard(other);
+                return join(left, right);
+            }
+            return join(left, context.take(other), right);
+        }
+
+        template <bool Owned, typename Operation>
+        void combine(Operation operation) {
+            Serial<Owned> context{*this};
+            auto tree = Subtree{root, black_height(root)};
+            set_combined(operation(tree, context));
+        }
+
+        // copies — сколько узлов операция может скопировать из other.
+        template <bool Owned, typename Operation>
+        void combine(
+            const Parallel& policy,
+            std::size_t other_size,
+            std::size_t copies,
+            Operation operation) {
+            if (policy.threads().size() == 0) {
+                return combine<Owned>(operation);
+            }
+            Batch batch{copies ? pool_.allocate_batch(copies) : nullptr, 0};
+            Concurrent<Owned> context(*this, batch, policy, other_size);
+            auto tree = Subtree{root, black_height(root)};
+            set_combined(operation(tree, context));
+            for (auto node : context.garbage) {
+                pool_.recycle(node);
+            }
+            if (copies) {
+                pool_.release_batch(batch.slots, batch.used.load(), copies);
+            }
+            size_ = std::size_t(std::ptrdiff_t(size_) + context.delta);
+        }
+
+        auto uniting(Node* other_root, const Node* other_null) {
+            return [this, other_root, other_null](
+                       Subtree tree, auto& context) {
+                return unite(tree, other_root, other_null, context);
+            };
+        }
+
+        auto intersecting(Node* other_root, const Node* other_null) {
+            return [this, other_root, other_null](
+                       Subtree tree, auto& context) {
+                return intersect(tree, other_root, other_null, context);
+            };
+        }
+
+        void set_combined(Subtree result) {
+            root = result.root;
+            if (root == null_node) {
+                min_ = null_node;
+                set_max(null_node);
+            } else {
+                root->set_parent(null_node);
+                min_ = min(root);
+                set_max(max(root));
+            }
+            rethread();
+        }
+
+        // Забирает узлы other в свой пул; other становится пустым, но
+        // его дерево остается на месте до конца операции.
+        Node* adopt(Set& other) {
+            pool_.splice(other.pool_);
+            auto other_root = other.root;
+            other.root = other.null_node;
+            other.min_ = other.null_node;
+            other.set_max(other.null_node);
+            other.size_ = 0;
+            other.rethread();
+            return other_root;
+        }
+
+        // Обходит поддерево по возрастанию; f может перецепить узел.
+        template <typename F>
+        static void drain(Node* node, F& f) {
+            while (!detail::is_null(node)) {
+                drain(node->left, f);
+                auto right = node->right;
+                f(node);
+                node = right;
+            }
+        }
+
+        bool can_adopt(const Set& other) const {
+            return node_alloc_traits::is_always_equal::value ||
+                pool_.get_allocator() == other.pool_.get_allocator();
+        }
+
+        void print_tree(Node* root, std::string path) const {
+            if (root == null_node) {
+                return;
+            }
+            print_tree(root->left, path + "l");
+            std::cout << root->key << " " << path << std::endl;
+            print_tree(root->right, path + "r");
+        }
+
+       public:
+        using key_type = T;
+        using value_type = T;
+        using key_compare = Compare;
+        using value_compare = Compare;
+        using allocator_type = Allocator;
+
+        Set() : Set(Compare()) {
+        }
+
+        explicit Set(const Compare& comp, const Allocator& alloc = Allocator())
             : root(nullptr),
-              null_node(new detail::Node<T>(0, BLACK)),
+              null_node(nullptr),
               min_(nullptr),
-              max_(nullptr),
-              size_(0) {
-            null_node->parent = null_node;
-            null_node->left = null_node;
-            null_node->right = null_node;
+              size_(0),
+              comp_(comp),
+              pool_(node_allocator(alloc)) {
+            null_node = create_null_node();
             root = null_node;
-            min_ = &null_node;
-            max_ = &null_node;
+            min_ = null_node;
+        };
+
+        explicit Set(const Allocator& alloc) : Set(Compare(), alloc) {
+        }
 
-            for (const auto& lElem : list) {
-                insert(lElem);
+        Set(T key, const Allocator& alloc = Allocator())
+            : Set(Compare(), alloc) {
+            insert(std::move(key));
+        };
+
+        // Произвольный диапазон: копируется, при необходимости сортируется
+        // и очищается от повторов, затем дерево строится за O(n).
+        template <std::input_iterator It>
+        Set(It first,
+            It last,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : Set(comp, alloc) {
+            auto keys = detail::sorted_unique<T>(first, last, comp_);
+            build_sorted(std::make_move_iterator(keys.begin()), keys.size());
+        }
+
+        Set(std::initializer_list<T> list,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+            : Set(list.begin(), list.end(), comp, alloc) {
+        }
+
+        Set(std::initializer_list<T> list, const Allocator& alloc)
+            : Set(list, Compare(), alloc) {
+        }
+
+        // Диапазон должен быть строго возрастающим относительно comp.
+        template <std::input_iterator It>
+        static Set from_sorted(
+            It first,
+            It last,
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator()) {
+            Set set(comp, alloc);
+            if constexpr (std::forward_iterator<It>) {
+                set.build_sorted(first, std::distance(first, last));
+            } else {
+                std::vector<T> keys(first, last);
+                set.build_sorted(
+                    std::make_move_iterator(keys.begin()), keys.size());
+            }
+            return set;
+        }
+
+        // Параллельный from_sorted: узлы выделяются одним блоком и
+        // лежат в нем в порядке ключей, поддеревья строятся на пуле.
+        template <std::random_access_iterator It>
+        static Set parallel_from_sorted(
+            It first,
+            It last,
+            const Parallel& policy = {},
+            const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator()) {
+            Set set(comp, alloc);
+            auto n = std::size_t(last - first);
+            if (n != 0) {
+                auto slots = set.pool_.allocate_batch(n);
+                set.set_built(
+                    set.build_parallel(
+                        first, slots, n, 0, red_depth(n), policy),
+                    n);
             }
+            return set;
         }
 
         void print() const {
-            std::cout << (*min_)->key << std::endl;
-            std::cout << (*max_)->key << std::endl;
+            std::cout << min_->key << std::endl;
+            std::cout << max_node()->key << std::endl;
             print_tree(root, "m");
         }
 
-        Set(const Set<T>& other)
-            : root(nullptr),
-              null_node(nullptr),
-              min_(nullptr),
-              max_(nullptr),
-              size_(0) {
-            if (other.root != nullptr) {
-                null_node = new detail::Node<T>(0);
-                copy_nodes(&root, other.root, &null_node, other);
-            }
+        Set(const Set& other)
+            : Set(other.comp_,
+                  std::allocator_traits<Allocator>::
+                      select_on_container_copy_construction(
+                          Allocator(other.pool_.get_allocator()))) {
+            copy_nodes(other);
+            rethread();
         }
 
         //Оператор копирования:
         Set& operator=(const Set& other) {
             if (this != &other) {
                 clear();
-                size_ = 0;
-                copy_nodes(&root, other.root, &null_node, other);
+                comp_ = other.comp_;
+                copy_nodes(other);
+                rethread();
             }
             return *this;
         };
 
         //Конструктор перемещения:
         Set(Set&& other)
-            : root(other.root),
-              null_node(other.null_node),
-              min_(other.min_),
-              max_(other.max_),
-              size_(other.size_) {
-            other.root = nullptr;
-            other.null_node = nullptr;
-            other.min_ = nullptr;
-            other.max_ = nullptr;
-            other.size_ = 0;
+            : root(nullptr),
+              null_node(nullptr),
+              min_(nullptr),
+              size_(0),
+              comp_(std::move(other.comp_)),
+              pool_(std::move(other.pool_)) {
+            steal(other);
         };
 
         //Оператор перемещения:
         Set& operator=(Set&& other) {
+            if constexpr (!node_alloc_traits::
+                              propagate_on_container_move_assignment::value) {
+                // узлы other нельзя забрать в чужой пул: ключи переносятся
+                // поэлементно, как в стандартных контейнерах
+                if (this != &other && !can_adopt(other)) {
+                    clear();
+                    comp_ = std::move(other.comp_);
+                    std::vector<T> keys;
+                    keys.reserve(other.size_);
+                    for (auto node = other.min_; node != other.null_node;
+                         node = other.next_node(node)) {
+                        keys.push_back(std::move(node->key));
+                    }
+                    other.clear();
+                    build_sorted(
+                        std::make_move_iterator(keys.begin()), keys.size());
+                    return *this;
+                }
+            }
             if (this != &other) {
                 clear();
-                root = other.root;
-                null_node = other.null_node;
-                min_ = other.min_;
-                max_ = other.max_;
-                size_ = other.size_;
-                other.root = nullptr;
-                other.null_node = nullptr;
-                other.min_ = nullptr;
-                other.max_ = nullptr;
-                other.size_ = 0;
+                destroy_null_node();
+                comp_ = std::move(other.comp_);
+                pool_ = std::move(other.pool_);
+                steal(other);
             }
             return *this;
         };
 
         ~Set() {
             clear();
-            if (null_node) {
-                delete null_node;
-            }
+            destroy_null_node();
+        }
+
+        allocator_type get_allocator() const {
+            return Allocator(pool_.get_allocator());
         }
 
+        key_compare key_comp() const {
+            return comp_;
+        }
+
+        value_compare value_comp() const {
+            return comp_;
+        }
+
+        // Ключи разрушаются обходом только если это необходимо, память
+        // всех узлов освобождается пулом за O(1) от числа элементов.
         void clear() {
             if (size_) {
-                clear(root);
+                if constexpr (!std::is_trivially_destructible_v<
+                                  Node>) {
+                    clear(root);
+                }
+                pool_.release();
+                size_ = 0;
+                root = null_node;
+                min_ = null_node;
+                set_max(null_node);
+                rethread();
             }
         }
 
-        bool contains(T key) const {
-            detail::Node<T>* tmp = find(key, root);
-            return (tmp && tmp->key == key);
+        bool contains(const T& key) const {
+            return find_node(key) != null_node;
         }
 
-        void erase(T key) {
-            remove(key, root);
+        template <typename K>
+        requires detail::transparent<Compare>
+        bool contains(const K& key) const {
+            return find_node(key) != null_node;
+        }
+
+        std::size_t count(const T& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t count(const K& key) const {
+            return contains(key) ? 1 : 0;
+        }
+
+        std::size_t erase(const T& key) {
+            return erase_key(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::size_t erase(const K& key) {
+            return erase_key(key);
         }
 
         bool empty() const {
@@ -513,78 +1974,31 @@ namespace treeset {
             using reference = Value_type&;
             using iterator_category = std::bidirectional_iterator_tag;
 
-            Iterator(
-                detail::Node<T>* current,
-                detail::Node<T>* prev,
-                detail::Node<T>* null_node,
-                detail::Node<T>* root)
-                : current_(current),
-                  prev_(prev),
-                  null_node_(null_node),
-                  root_(root){};
-            Iterator(const Iterator& it)
-                : current_(it.current_),
-                  prev_(it.prev_),
-                  null_node_(it.null_node_),
-                  root_(it.root_){};
-
-            Iterator(Iterator&& it)
-                : current_(it.current_),
-                  prev_(it.prev_),
-                  null_node_(it.null_node_),
-                  root_(it.root_) {
-                it.current_ = nullptr;
-                it.prev_ = nullptr;
-                it.null_node_ = nullptr;
-                it.root_ = nullptr;
-            }
-
-            Iterator& operator=(const Iterator& it) {
-                this->current_ = it.current_;
-                this->prev_ = it.prev_;
-                this->null_node_ = it.null_node_;
-                this->root_ = it.root_;
-                return *this;
-            }
-
-            Iterator& operator=(Iterator&& it) {
-                current_ = it.current_;
-                prev_ = it.prev_;
-                null_node_ = it.null_node_;
-                root_ = it.root_;
-                it.current_ = nullptr;
-                it.prev_ = nullptr;
-                it.null_node_ = nullptr;
-                it.root_ = nullptr;
-                return *this;
+            Iterator() : current_(nullptr) {
             }
 
-            ~Iterator() {
-            }
-
-            std::pair<Iterator<T>, bool>& operator=(
-                const std::pair<Iterator<T>, bool>& other) {
-                this->first = other.first;
-                this->second = other.second;
-                return *this;
+            explicit Iterator(Node* current) : current_(current) {
             }
 
             // префиксный инкремент
             Iterator& operator++() {
-                if (current_->right != null_node_) {
-                    current_ = current_->right;
-                    while (current_->left != null_node_) {
+                if constexpr (linked) {
+                    current_ = current_->thread.next;
+                    return *this;
+                }
+                auto right = current_->right;
+                if (!detail::is_null(right)) {
+                    current_ = right;
+                    while (!detail::is_null(current_->left)) {
                         current_ = current_->left;
                     }
                 } else {
-                    auto tmp = current_->parent;
-                    while (current_ == tmp->right) {
-                        current_ = tmp;
-                        tmp = tmp->parent;
-                    }
-                    if (current_->right != tmp) {
-                        current_ = tmp;
+                    auto parent = current_->parent();
+                    while (current_ == parent->right) {
+                        current_ = parent;
+                        parent = parent->parent();
                     }
+                    current_ = parent;
                 }
                 return *this;
             }
@@ -598,56 +2012,42 @@ namespace treeset {
 
             Iterator operator+(int value) {
                 auto new_iter = *this;
-                for (int i = 0; i < value; i++) {
-                    new_iter++;
-                }
+                new_iter += value;
                 return new_iter;
             }
 
             Iterator& operator+=(int value) {
-                for (int i = 0; i < value; i++) {
-                    (*this)++;
+                if constexpr (counted) {
+                    advance(value);
+                } else {
+                    for (int i = 0; i < value; i++) {
+                        (*this)++;
+                    }
                 }
                 return *this;
             }
 
-            //префиксный декремент
+            // префиксный декремент; из end() сразу в максимум через
+            // заголовок
             Iterator& operator--() {
-                if (current_ == null_node_) {
-                    auto max = root_;
-                    while (max->right != null_node_) {
-                        max = max->right;
-                    }
-                    prev_ = null_node_;
-                    current_ = max;
-                } else if (
-                    prev_ != current_->left && current_->left != null_node_) {
-                    prev_ = current_;
+                if constexpr (linked) {
+                    current_ = current_->thread.prev;
+                    return *this;
+                }
+                if (detail::is_null(current_)) {
+                    current_ = current_->parent();
+                } else if (!detail::is_null(current_->left)) {
                     current_ = current_->left;
-                    while (current_->right != null_node_) {
-                        prev_ = current_;
+                    while (!detail::is_null(current_->right)) {
                         current_ = current_->right;
                     }
-                } else if (
-                    prev_ != current_->right && prev_ != current_->left &&
-                    current_->right != null_node_) {
-                    while (current_->right != null_node_) {
-                        prev_ = current_;
-                        current_ = current_->right;
-                    }
-
                 } else {
-                    while (current_ == current_->parent->left &&
-                           current_->parent != null_node_) {
-                        prev_ = current_;
-                        current_ = current_->parent;
-                    }
-                    if (current_->parent == null_node_) {
-                        current_ = null_node_;
-                    } else {
-                        prev_ = current_;
-                        current_ = current_->parent;
+                    auto parent = current_->parent();
+                    while (current_ == parent->left) {
+                        current_ = parent;
+                        parent = parent->parent();
                     }
+                    current_ = parent;
                 }
                 return *this;
             }
@@ -661,19 +2061,36 @@ namespace treeset {
 
             Iterator operator-(int value) {
                 auto new_iter = *this;
-                for (int i = 0; i < value; i++) {
-                    new_iter--;
-                }
+                new_iter -= value;
                 return new_iter;
             }
 
             Iterator& operator-=(int value) {
-                for (int i = 0; i < value; i++) {
-                    (*this)--;
+                if constexpr (counted) {
+                    advance(-difference_type(value));
+                } else {
+                    for (int i = 0; i < value; i++) {
+                        (*this)--;
+                    }
                 }
                 return *this;
             }
 
+            // Расстояние от rhs до *this; без order_statistics rhs должен
+            // предшествовать *this.
+            difference_type operator-(const Iterator& rhs) const {
+                if constexpr (counted) {
+                    return difference_type(index()) -
+                        difference_type(rhs.index());
+                } else {
+                    difference_type distance = 0;
+                    for (auto iter = rhs; iter != *this; ++iter) {
+                        ++distance;
+                    }
+                    return distance;
+                }
+            }
+
             reference operator*() const {
                 return current_->key;
             }
@@ -687,96 +2104,683 @@ namespace treeset {
             }
 
            private:
-            detail::Node<T>* current_;
-            detail::Node<T>* prev_;
-            detail::Node<T>* null_node_;
-            detail::Node<T>* root_;
+            friend class Set;
+
+            // Номер в порядке обхода и корень дерева; из end() путь к
+            // корню идёт через максимум.
+            std::pair<std::size_t, Node*> position() const {
+                if (!detail::is_null(current_)) {
+                    return detail::rank_and_root(current_);
+                }
+                auto max = current_->parent();
+                if (detail::is_null(max)) {
+                    return std::make_pair(std::size_t(0), max);
+                }
+                auto root = detail::rank_and_root(max).second;
+                return std::make_pair(root->size, root);
+            }
+
+            std::size_t index() const {
+                return position().first;
+            }
+
+            void advance(difference_type diff) {
+                auto [index, root] = position();
+                if (!detail::is_null(root)) {
+                    current_ =
+                        detail::select(root, root->parent(), index + diff);
+                }
+            }
+
+            Node* current_;
+        };
+
+        // Извлечённый элемент, как node_type в std::set: ключ можно
+        // изменить и вставить в это или другое множество того же типа.
+        // Узлы живут в чанках пула своего множества и не могут его
+        // пережить, поэтому ручка хранит сам ключ: извлечение и вставка
+        // переносят его без копирования, а слот узла берётся из пула.
+        class NodeHandle {
+           public:
+            using value_type = T;
+            using allocator_type = Allocator;
+
+            NodeHandle() = default;
+            NodeHandle(NodeHandle&&) = default;
+            NodeHandle& operator=(NodeHandle&&) = default;
+
+            bool empty() const {
+                return !key_.has_value();
+            }
+
+            explicit operator bool() const {
+                return key_.has_value();
+            }
+
+            value_type& value() const {
+                return *key_;
+            }
+
+            allocator_type get_allocator() const {
+                return *alloc_;
+            }
+
+           private:
+            friend class Set;
+
+            mutable std::optional<T> key_;
+            std::optional<Allocator> alloc_;
+
+            NodeHandle(T&& key, const Allocator& alloc)
+                : key_(std::move(key)), alloc_(alloc) {
+            }
+
+            void reset() {
+                key_.reset();
+                alloc_.reset();
+            }
         };
 
+        using node_type = NodeHandle;
+
+        struct insert_return_type {
+            Iterator<T> position;
+            bool inserted;
+            node_type node;
+        };
+
+       private:
+        Iterator<T> make_iterator(Node* node) const {
+            return Iterator<T>(node);
+        }
+
+        template <typename K>
+        std::pair<Iterator<T>, Iterator<T>> equal_range_nodes(
+            const K& key) const {
+            auto first = lower_bound_node(key);
+            auto last = first;
+            if (first != null_node && !comp_(key, first->key)) {
+                last = next_node(first);
+            }
+            return std::make_pair(make_iterator(first), make_iterator(last));
+        }
+
+       public:
         Iterator<T> begin() const {
-            return Iterator<T>(*min_, null_node, null_node, root);
+            return Iterator<T>(min_);
         }
 
         Iterator<T> end() const {
-            return Iterator<T>(null_node, null_node, null_node, root);
+            return Iterator<T>(null_node);
         }
 
         Iterator<T> max() const {
-            return Iterator<T>(*max_, null_node, null_node, root);
+            return Iterator<T>(max_node());
+        }
+
+        // Крайние элементы берутся из закэшированных min_ и max, без
+        // спуска от корня; на пустом множестве не вызывать.
+        const T& peek_min() const {
+            assert(!empty());
+            return min_->key;
+        }
+
+        const T& peek_max() const {
+            assert(!empty());
+            return max_node()->key;
+        }
+
+        // Извлекают крайний ключ, как из очереди с приоритетом; на пустом
+        // множестве не вызывать: удаление заголовка испортило бы дерево.
+        T pop_front() {
+            assert(!empty());
+            auto node = min_;
+            T key = std::move(node->key);
+            remove(node);
+            return key;
+        }
+
+        T pop_back() {
+            assert(!empty());
+            auto node = max_node();
+            T key = std::move(node->key);
+            remove(node);
+            return key;
         }
 
         Iterator<T> find(const T& key) const {
-            auto node = root;
-            while (node != null_node) {
-                if (node->key < key) {
-                    node = node->right;
-                } else if (node->key > key) {
-                    node = node->left;
-                } else {
-                    return Iterator<T>(node, null_node, null_node, root);
-                }
+            return Iterator<T>(find_node(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator<T> find(const K& key) const {
+            return Iterator<T>(find_node(key));
+        }
+
+        std::pair<Iterator<T>, bool> insert(const T& key) {
+            return try_emplace(key);
+        }
+
+        std::pair<Iterator<T>, bool> insert(T&& key) {
+            return try_emplace(std::move(key));
+        }
+
+        // Ключ конструируется до поиска; при дубликате узел сразу
+        // возвращается в пул.
+        template <typename... Args>
+        std::pair<Iterator<T>, bool> emplace(Args&&... args) {
+            auto node =
+                pool_.create(std::in_place, std::forward<Args>(args)...);
+            auto [pos, side] = insert_position(node->key);
+            if (side == 0 && pos != null_node) {
+                pool_.destroy(node);
+                return std::make_pair(Iterator<T>(pos), false);
             }
-            return end();
+            attach(pos, side, node);
+            return std::make_pair(Iterator<T>(node), true);
         }
 
-        std::pair<Iterator<T>, bool> insert(T key) {
-            if (root == null_node) {
-                root = new detail::Node<T>(
-                    key, BLACK, null_node, null_node, null_node);
-                ++size_;
-                min_ = &root;
-                max_ = &root;
-                return std::make_pair(find(key), true);
-            }
-
-            detail::Node<T>* tmp = find(key, root);
-            if (tmp != null_node && tmp->key != key) {
-                if (tmp->key < key) {
-                    tmp->right = new detail::Node<T>(
-                        key, RED, tmp, null_node, null_node);
-                    if (tmp == *max_) {
-                        max_ = &(tmp->right);
+        // Вставка с подсказкой, как в std::set: элемент ставится как можно
+        // ближе перед hint. Если он попадает прямо перед hint или сразу
+        // после него, поиска от корня нет и вставка стоит O(1)
+        // амортизированно.
+        Iterator<T> insert(Iterator<T> hint, const T& key) {
+            return Iterator<T>(insert_hinted(hint.current_, key));
+        }
+
+        Iterator<T> insert(Iterator<T> hint, T&& key) {
+            return Iterator<T>(
+                insert_hinted(hint.current_, std::move(key)));
+        }
+
+        template <typename... Args>
+        Iterator<T> emplace_hint(Iterator<T> hint, Args&&... args) {
+            auto node =
+                pool_.create(std::in_place, std::forward<Args>(args)...);
+            auto [pos, side] = insert_position_near(node->key, hint.current_);
+            if (side == 0 && pos != null_node) {
+                pool_.destroy(node);
+                return Iterator<T>(pos);
+            }
+            attach(pos, side, node);
+            return Iterator<T>(node);
+        }
+
+        // Удаляет элемент без поиска по ключу и возвращает итератор на
+        // следующий; итераторы на остальные элементы не портятся.
+        Iterator<T> erase(Iterator<T> position) {
+            return Iterator<T>(remove(position.current_));
+        }
+
+        Iterator<T> erase(Iterator<T> first, Iterator<T> last) {
+            auto node = first.current_;
+            while (node != last.current_) {
+                node = remove(node);
+            }
+            return last;
+        }
+
+        node_type extract(Iterator<T> position) {
+            auto node = position.current_;
+            node_type handle(std::move(node->key), get_allocator());
+            remove(node);
+            return handle;
+        }
+
+        node_type extract(const T& key) {
+            auto node = find_node(key);
+            return node == null_node ? node_type() : extract(Iterator<T>(node));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        node_type extract(const K& key) {
+            auto node = find_node(key);
+            return node == null_node ? node_type() : extract(Iterator<T>(node));
+        }
+
+        insert_return_type insert(node_type&& handle) {
+            if (handle.empty()) {
+                return insert_return_type{end(), false, node_type()};
+            }
+            auto [position, inserted] = try_emplace(std::move(*handle.key_));
+            if (!inserted) {
+                return insert_return_type{position, false, std::move(handle)};
+            }
+            handle.reset();
+            return insert_return_type{position, true, node_type()};
+        }
+
+        Iterator<T> insert(Iterator<T> hint, node_type&& handle) {
+            if (handle.empty()) {
+                return end();
+            }
+            auto before = size_;
+            auto node = insert_hinted(hint.current_, std::move(*handle.key_));
+            if (size_ != before) {
+                handle.reset();
+            }
+            return Iterator<T>(node);
+        }
+
+        // Переносит из other элементы, которых нет в *this; остальные
+        // остаются в other. При равных аллокаторах узлы other
+        // перецепляются в это дерево вместе с его чанками, без выделений и
+        // без переноса ключей; заново создаются только узлы для
+        // оставшихся в other дубликатов.
+        void merge(Set& other) {
+            if (this == &other || other.empty()) {
+                return;
+            }
+            if (!can_adopt(other)) {
+                for (auto node = other.min_; node != other.null_node;) {
+                    if (find_node(node->key) == null_node) {
+                        insert(std::move(node->key));
+                        node = other.remove(node);
+                    } else {
+                        node = other.next_node(node);
                     }
-                    add_autobalance(tmp->right);
+                }
+                return;
+            }
+            auto finger = null_node;
+            auto move_node = [this, &other, &finger](Node* node) {
+                auto [pos, side] =
+                    insert_position(node->key, climb(finger, node->key));
+                if (side == 0 && pos != null_node) {
+                    other.insert_hinted(other.null_node, std::move(node->key));
+                    pool_.destroy(node);
+                    finger = pos;
                 } else {
-                    tmp->left = new detail::Node<T>(
-                        key, RED, tmp, null_node, null_node);
-                    if (tmp == *min_) {
-                        min_ = &(tmp->left);
-                    }
-                    add_autobalance(tmp->left);
+                    attach(pos, side, node);
+                    finger = node;
                 }
-                ++size_;
+            };
+            drain(adopt(other), move_node);
+        }
+
+        void merge(Set&& other) {
+            merge(other);
+        }
 
-                return std::make_pair(find(key), true);
+        // Элемент конструируется из key только если равного key ещё нет
+        // в множестве. Позиция ищется по самому key, поэтому T(key) обязан
+        // быть эквивалентен key; ключ из нескольких аргументов строит
+        // emplace.
+        template <typename K>
+        std::pair<Iterator<T>, bool> try_emplace(K&& key) {
+            auto [pos, side] = insert_position(key);
+            if (side == 0 && pos != null_node) {
+                return std::make_pair(Iterator<T>(pos), false);
             }
-            return std::make_pair(find(key), false);
+            auto node = pool_.create(std::in_place, std::forward<K>(key));
+            attach(pos, side, node);
+            return std::make_pair(Iterator<T>(node), true);
         }
 
         Iterator<T> lower_bound(const T& key) const {
-            return find(key);
+            return make_iterator(lower_bound_node(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator<T> lower_bound(const K& key) const {
+            return make_iterator(lower_bound_node(key));
         }
 
         Iterator<T> upper_bound(const T& key) const {
-            auto iter = find(key);
-            if (iter == end()) {
-                return end();
-            }
-            return find(key) + 1;
+            return make_iterator(upper_bound_node(key));
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        Iterator<T> upper_bound(const K& key) const {
+            return make_iterator(upper_bound_node(key));
         }
 
         std::pair<Iterator<T>, Iterator<T>> equal_range(const T& key) const {
-            auto l_bound = lower_bound(key);
-            if (l_bound == end()) {
-                return std::make_pair(end(), end());
+            return equal_range_nodes(key);
+        }
+
+        template <typename K>
+        requires detail::transparent<Compare>
+        std::pair<Iterator<T>, Iterator<T>> equal_range(const K& key) const {
+            return equal_range_nodes(key);
+        }
+
+        // Элементы из полуинтервала [lo, hi).
+        template <typename K>
+        Range<Iterator<T>> range(const K& lo, const K& hi) const {
+            auto first = lower_bound_node(lo);
+            auto last = comp_(lo, hi) ? lower_bound_node(hi) : first;
+            return Range<Iterator<T>>(
+                make_iterator(first), make_iterator(last));
+        }
+
+        template <typename K>
+        std::size_t count_range(const K& lo, const K& hi) const {
+            if constexpr (counted) {
+                if (!comp_(lo, hi)) {
+                    return 0;
+                }
+                return rank_of(lower_bound_node(hi)) -
+                    rank_of(lower_bound_node(lo));
+            } else {
+                auto view = range(lo, hi);
+                return std::distance(view.begin(), view.end());
             }
-            auto u_bound = l_bound + 1;
-            return std::make_pair(l_bound, u_bound);
         }
 
-        void swap(Set<T>& other) {
+        // k-й по порядку элемент (с нуля), end() при k >= size().
+        Iterator<T> nth(std::size_t k) const requires counted {
+            return make_iterator(detail::select(root, null_node, k));
+        }
+
+        // Число элементов, меньших key.
+        template <typename K>
+        std::size_t rank(const K& key) const requires counted {
+            return rank_of(lower_bound_node(key));
+        }
+
+        // Неизменяемая копия в плоском массиве для частых поисков;
+        // для вызова нужен libset/frozen_set.hpp.
+        FrozenSet<T, Compare, Allocator> freeze() const {
+            return FrozenSet<T, Compare, Allocator>::from_sorted(
+                begin(), end(), comp_, get_allocator());
+        }
+
+        template <typename K>
+        std::size_t erase_range(const K& lo, const K& hi) {
+            std::size_t count = 0;
+            auto node = lower_bound_node(lo);
+            while (node != null_node && comp_(node->key, hi)) {
+                node = remove(node);
+                ++count;
+            }
+            return count;
+        }
+
+        void swap(Set& other) {
             std::swap(*this, other);
         }
+
+        // Теоретико-множественные операции на основе split/join за
+        // O(m log(n / m + 1)). Версии с Set&& переиспользуют узлы other
+        // без выделения памяти, other остается пустым.
+        void union_with(const Set& other) {
+            if (this != &other) {
+                combine<false>(uniting(other.root, other.null_node));
+            }
+        }
+
+        void union_with(Set&& other) {
+            if (this == &other || !can_adopt(other)) {
+                return union_with(static_cast<const Set&>(other));
+            }
+            auto other_null = other.null_node;
+            auto other_root = adopt(other);
+            combine<true>(uniting(other_root, other_null));
+        }
+
+        // Пакетные изменения: ключи сортируются и применяются за один
+        // проход слева направо, каждый спуск начинается от места
+        // предыдущего ключа, а не от корня. Возвращают число вставленных
+        // или удалённых элементов.
+        std::size_t insert_batch(std::span<const T> keys) {
+            auto sorted =
+                detail::sorted_unique<T>(keys.begin(), keys.end(), comp_);
+            auto before = size_;
+            if (empty()) {
+                *this = from_sorted(
+                    std::make_move_iterator(sorted.begin()),
+                    std::make_move_iterator(sorted.end()), comp_,
+                    get_allocator());
+            } else {
+                apply_sorted(
+                    std::make_move_iterator(sorted.begin()),
+                    std::make_move_iterator(sorted.end()),
+                    [](const T&) { return false; });
+            }
+            return size_ - before;
+        }
+
+        std::size_t erase_batch(std::span<const T> keys) {
+            auto sorted =
+                detail::sorted_unique<T>(keys.begin(), keys.end(), comp_);
+            auto before = size_;
+            apply_sorted(
+                sorted.begin(), sorted.end(), [](const T&) { return true; });
+            return before - size_;
+        }
+
+        // Результат как у последовательного применения ops: из операций
+        // с равными ключами действует последняя.
+        void apply_batch(std::span<const BatchOp<T>> ops) {
+            std::vector<const BatchOp<T>*> sorted;
+            sorted.reserve(ops.size());
+            for (const auto& op : ops) {
+                sorted.push_back(&op);
+            }
+            std::stable_sort(
+                sorted.begin(), sorted.end(),
+                [this](const BatchOp<T>* lhs, const BatchOp<T>* rhs) {
+                    return comp_(lhs->key, rhs->key);
+                });
+            std::vector<T> keys;
+            std::vector<bool> erase;
+            keys.reserve(sorted.size());
+            for (std::size_t i = 0; i < sorted.size(); i++) {
+                if (i + 1 == sorted.size()
+                    || comp_(sorted[i]->key, sorted[i + 1]->key)) {
+                    keys.push_back(sorted[i]->key);
+                    erase.push_back(sorted[i]->kind == BatchOp<T>::erase);
+                }
+            }
+            std::size_t index = 0;
+            apply_sorted(
+                std::make_move_iterator(keys.begin()),
+                std::make_move_iterator(keys.end()),
+                [&](const T&) { return erase[index++]; });
+        }
+
+        void intersect_with(const Set& other) {
+            if (this != &other) {
+                combine<false>(intersecting(other.root, other.null_node));
+            }
+        }
+
+        void intersect_with(Set&& other) {
+            if (this == &other || !can_adopt(other)) {
+                return intersect_with(static_cast<const Set&>(other));
+            }
+            auto other_null = other.null_node;
+            auto other_root = adopt(other);
+            combine<true>(intersecting(other_root, other_null));
+        }
+
+        void difference_with(const Set& other) {
+            if (this == &other) {
+                clear();
+                return;
+            }
+            combine<false>([this, &other](Subtree tree, auto& context) {
+                return subtract(tree, other.root, other.null_node, context);
+            });
+        }
+
+        void difference_with(Set&& other) {
+            if (this == &other || !can_adopt(other)) {
+                return difference_with(static_cast<const Set&>(other));
+            }
+            auto other_null = other.null_node;
+            auto other_root = adopt(other);
+            combine<true>(
+                [this, other_root, other_null](Subtree tree, auto& context) {
+                    return subtract(tree, other_root, other_null, context);
+                });
+        }
+
+        void symmetric_difference_with(const Set& other) {
+            if (this == &other) {
+                clear();
+                return;
+            }
+            combine<false>([this, &other](Subtree tree, auto& context) {
+                return symmetric_subtract(
+                    tree, other.root, other.null_node, context);
+            });
+        }
+
+        void symmetric_difference_with(Set&& other) {
+            if (this == &other || !can_adopt(other)) {
+                return symmetric_difference_with(
+                    static_cast<const Set&>(other));
+            }
+            auto other_null = other.null_node;
+            auto other_root = adopt(other);
+            combine<true>(
+                [this, other_root, other_null](Subtree tree, auto& context) {
+                    return symmetric_subtract(
+                        tree, other_root, other_null, context);
+                });
+        }
+
+        // Параллельные версии: ветки рекурсии split/join, в которых больше
+        // policy.grain элементов, выполняются на пуле потоков.
+        void parallel_union_with(
+            const Set& other,
+            const Parallel& policy = {}) {
+            if (this != &other) {
+                combine<false>(
+                    policy, other.size_, other.size_,
+                    uniting(other.root, other.null_node));
+            }
+        }
+
+        void parallel_union_with(Set&& other, const Parallel& policy = {}) {
+            if (this == &other || !can_adopt(other)) {
+                return parallel_union_with(
+                    static_cast<const Set&>(other), policy);
+            }
+            auto other_size = other.size_;
+            auto other_null = other.null_node;
+            auto other_root = adopt(other);
+            combine<true>(
+                policy, other_size, 0, uniting(other_root, other_null));
+        }
+
+        void parallel_intersect_with(
+            const Set& other,
+            const Parallel& policy = {}) {
+            if (this != &other) {
+                combine<false>(
+                    policy, other.size_, 0,
+                    intersecting(other.root, other.null_node));
+            }
+        }
+
+        void parallel_intersect_with(
+            Set&& other,
+            const Parallel& policy = {}) {
+            if (this == &other || !can_adopt(other)) {
+                return parallel_intersect_with(
+                    static_cast<const Set&>(other), policy);
+            }
+            auto other_size = other.size_;
+            auto other_null = other.null_node;
+            auto other_root = adopt(other);
+            combine<true>(
+                policy, other_size, 0, intersecting(other_root, other_null));
+        }
+
+        // Вызывает f(const T&) для каждого элемента; порядок вызовов не
+        // определен, f может вызываться из нескольких потоков сразу.
+        template <typename F>
+        void parallel_for_each(F f, const Parallel& policy = {}) const {
+            visit_parallel(root, black_height(root), f, policy);
+        }
+
+        // Сворачивает transform(x) по всем элементам ассоциативной
+        // операцией reduce в порядке возрастания ключей; identity —
+        // нейтральный элемент reduce.
+        template <typename R, typename Reduce, typename Transform>
+        R parallel_reduce(
+            R identity,
+            Reduce reduce,
+            Transform transform,
+            const Parallel& policy = {}) const {
+            return reduce_parallel(
+                root, black_height(root), identity, reduce, transform,
+                policy);
+        }
     };
 
+    template <
+        typename T,
+        typename Compare,
+        typename Allocator,
+        unsigned Options>
+    Set<T, Compare, Allocator, Options> set_union(
+        const Set<T, Compare, Allocator, Options>& lhs,
+        const Set<T, Compare, Allocator, Options>& rhs) {
+        const auto& larger = lhs.size() < rhs.size() ? rhs : lhs;
+        const auto& smaller = lhs.size() < rhs.size() ? lhs : rhs;
+        Set<T, Compare, Allocator, Options> result(larger);
+        result.union_with(smaller);
+        return result;
+    }
+
+    template <
+        typename T,
+        typename Compare,
+        typename Allocator,
+        unsigned Options>
+    Set<T, Compare, Allocator, Options> set_intersection(
+        const Set<T, Compare, Allocator, Options>& lhs,
+        const Set<T, Compare, Allocator, Options>& rhs) {
+        const auto& larger = lhs.size() < rhs.size() ? rhs : lhs;
+        const auto& smaller = lhs.size() < rhs.size() ? lhs : rhs;
+        Set<T, Compare, Allocator, Options> result(smaller);
+        result.intersect_with(larger);
+        return result;
+    }
+
+    template <
+        typename T,
+        typename Compare,
+        typename Allocator,
+        unsigned Options>
+    Set<T, Compare, Allocator, Options> set_difference(
+        const Set<T, Compare, Allocator, Options>& lhs,
+        const Set<T, Compare, Allocator, Options>& rhs) {
+        Set<T, Compare, Allocator, Options> result(lhs);
+        result.difference_with(rhs);
+        return result;
+    }
+
+    template <
+        typename T,
+        typename Compare,
+        typename Allocator,
+        unsigned Options>
+    Set<T, Compare, Allocator, Options> symmetric_difference(
+        const Set<T, Compare, Allocator, Options>& lhs,
+        const Set<T, Compare, Allocator, Options>& rhs) {
+        const auto& larger = lhs.size() < rhs.size() ? rhs : lhs;
+        const auto& smaller = lhs.size() < rhs.size() ? lhs : rhs;
+        Set<T, Compare, Allocator, Options> result(larger);
+        result.symmetric_difference_with(smaller);
+        return result;
+    }
+
+    template <std::input_iterator It>
+    Set(It, It) -> Set<std::iter_value_t<It>>;
+
+    template <
+        typename T,
+        typename Compare = std::less<>,
+        typename Allocator = std::allocator<T>>
+    using OrderedSet = Set<T, Compare, Allocator, order_statistics>;
+
 }  // namespace treeset
\ No newline at end of file
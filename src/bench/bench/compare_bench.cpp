@@ -0,0 +1,94 @@
+// Число сравнений ключей на insert, find и erase: с одним трёхсторонним
+// сравнением на уровень (std::less<> и operator<=>) и с компаратором,
+// который умеет только operator<.
+#include <algorithm>
+#include <chrono>
+#include <compare>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <libset/treeset.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    std::size_t comparisons = 0;
+
+    struct Key {
+        std::string value;
+
+        bool operator<(const Key& rhs) const {
+            ++comparisons;
+            return value < rhs.value;
+        }
+
+        std::weak_ordering operator<=>(const Key& rhs) const {
+            ++comparisons;
+            return value <=> rhs.value;
+        }
+
+        bool operator==(const Key& rhs) const {
+            return value == rhs.value;
+        }
+    };
+
+    struct LessOnly {
+        bool operator()(const Key& lhs, const Key& rhs) const {
+            return lhs < rhs;
+        }
+    };
+
+    template <typename Set>
+    void measure(const char* name, const std::vector<Key>& keys) {
+        using clock = std::chrono::steady_clock;
+        auto report = [&](const char* operation, auto&& body) {
+            comparisons = 0;
+            auto start = clock::now();
+            body();
+            std::chrono::duration<double, std::milli> elapsed =
+                clock::now() - start;
+            std::cout << std::setw(10) << name << std::setw(8) << operation
+                      << std::setw(12) << std::fixed << std::setprecision(1)
+                      << double(comparisons) / double(keys.size())
+                      << std::setw(12) << elapsed.count() << '\n';
+        };
+
+        Set set;
+        report("insert", [&] {
+            for (const auto& key : keys) {
+                set.insert(key);
+            }
+        });
+        report("find", [&] {
+            std::size_t found = 0;
+            for (const auto& key : keys) {
+                found += set.contains(key) ? 1 : 0;
+            }
+            if (found != keys.size()) {
+                std::cerr << "lookup mismatch\n";
+            }
+        });
+        report("erase", [&] {
+            for (const auto& key : keys) {
+                set.erase(key);
+            }
+        });
+    }
+}  // namespace
+
+int main() {
+    const std::size_t n = 200000;
+    std::mt19937 rng(42);
+    std::vector<Key> keys;
+    keys.reserve(n);
+    for (std::size_t i = 0; i < n; i++) {
+        // общий префикс делает каждое сравнение строк заметно дороже
+        keys.push_back(Key{"user/" + std::to_string(rng())});
+    }
+
+    std::cout << std::setw(10) << "compare" << std::setw(8) << "op"
+              << std::setw(12) << "cmp/op" << std::setw(12) << "ms" << '\n';
+    measure<treeset::Set<Key, LessOnly>>("operator<", keys);
+    measure<treeset::Set<Key>>("<=>", keys);
+}
@@ -0,0 +1,92 @@
+// Пропускная способность ConcurrentSet и Set под std::shared_mutex при
+// росте числа потоков: 80% contains, 10% insert, 10% erase по ключам
+// из общего диапазона.
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <libset/concurrent_set.hpp>
+#include <libset/treeset.hpp>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    const int key_range = 1 << 20;
+    const std::size_t total_ops = 4000000;
+
+    class LockedSet {
+       public:
+        bool insert(int key) {
+            std::unique_lock lock(mutex_);
+            return set_.insert(key).second;
+        }
+
+        std::size_t erase(int key) {
+            std::unique_lock lock(mutex_);
+            return set_.erase(key);
+        }
+
+        bool contains(int key) const {
+            std::shared_lock lock(mutex_);
+            return set_.contains(key);
+        }
+
+       private:
+        mutable std::shared_mutex mutex_;
+        treeset::Set<int> set_;
+    };
+
+    template <typename Set>
+    double measure(int threads) {
+        Set set;
+        std::mt19937 rng(1);
+        for (int i = 0; i < key_range / 2; i++) {
+            set.insert(int(rng() % key_range));
+        }
+
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&set, threads, t] {
+                std::mt19937 rng(t + 2);
+                std::size_t found = 0;
+                for (std::size_t i = 0; i < total_ops / threads; i++) {
+                    int key = int(rng() % key_range);
+                    auto op = rng() % 10;
+                    if (op == 0) {
+                        set.insert(key);
+                    } else if (op == 1) {
+                        set.erase(key);
+                    } else {
+                        found += set.contains(key) ? 1 : 0;
+                    }
+                }
+                volatile std::size_t sink = found;
+                (void)sink;
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        std::chrono::duration<double> elapsed = clock::now() - start;
+        return double(total_ops) / elapsed.count() / 1e6;
+    }
+}  // namespace
+
+int main() {
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency()
+              << '\n';
+    std::cout << std::setw(8) << "threads" << std::setw(16) << "concurrent"
+              << std::setw(16) << "shared_mutex" << "  (Mops/s)\n";
+    for (int threads = 1; threads <= 32; threads *= 2) {
+        auto concurrent = measure<treeset::ConcurrentSet<int>>(threads);
+        auto locked = measure<LockedSet>(threads);
+        std::cout << std::setw(8) << threads << std::setw(16) << std::fixed
+                  << std::setprecision(2) << concurrent << std::setw(16)
+                  << locked << '\n';
+    }
+}
@@ -0,0 +1,67 @@
+// Время копирующего конструктора, копирующего присваивания и
+// разрушения больших множеств в сравнении с std::set.
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <libset/treeset.hpp>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+    using clock = std::chrono::steady_clock;
+
+    template <typename F>
+    double seconds(F f) {
+        auto start = clock::now();
+        f();
+        std::chrono::duration<double> elapsed = clock::now() - start;
+        return elapsed.count();
+    }
+
+    template <typename Set, typename Key>
+    void measure(const char* name, const std::vector<Key>& keys) {
+        Set source(keys.begin(), keys.end());
+        double copy;
+        double assign;
+        double destroy;
+        {
+            Set* target = nullptr;
+            copy = seconds([&] { target = new Set(source); });
+            Set other(keys.begin(), keys.begin() + keys.size() / 2);
+            assign = seconds([&] { other = source; });
+            destroy = seconds([&] { delete target; });
+        }
+        std::cout << std::setw(16) << name << std::setw(12) << std::fixed
+                  << std::setprecision(3) << copy << std::setw(12) << assign
+                  << std::setw(12) << destroy << '\n';
+    }
+
+    template <typename Key>
+    void run(const char* title, const std::vector<Key>& keys) {
+        std::cout << title << ", " << keys.size() << " keys\n";
+        std::cout << std::setw(16) << "" << std::setw(12) << "copy"
+                  << std::setw(12) << "assign" << std::setw(12) << "destroy"
+                  << "  (s)\n";
+        measure<treeset::Set<Key>>("treeset::Set", keys);
+        measure<std::set<Key>>("std::set", keys);
+    }
+}  // namespace
+
+int main() {
+    const std::size_t n = 4000000;
+    std::mt19937 rng(1);
+    std::vector<int> ints(n);
+    for (auto& key : ints) {
+        key = int(rng());
+    }
+    run("int", ints);
+
+    std::vector<std::string> strings(n / 4);
+    for (auto& key : strings) {
+        key = "key-" + std::to_string(rng()) + std::to_string(rng());
+    }
+    run("std::string", strings);
+}
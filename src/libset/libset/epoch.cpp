@@ -0,0 +1,102 @@
+#include <atomic>
+#include <libset/epoch.hpp>
+
+namespace treeset {
+
+    namespace {
+        // Запись потока. Записи не освобождаются: поток при выходе лишь
+        // отдаёт свою запись следующему.
+        struct alignas(64) Record {
+            // 0 — поток не закреплён, иначе эпоха закрепления.
+            std::atomic<std::uint64_t> pinned{0};
+            std::atomic<bool> used{true};
+            Record* next = nullptr;
+            unsigned depth = 0;
+        };
+
+        std::atomic<std::uint64_t> global_epoch{1};
+        std::atomic<Record*> records{nullptr};
+
+        Record* acquire_record() {
+            for (auto record = records.load(std::memory_order_acquire); record;
+                 record = record->next) {
+                bool used = false;
+                if (!record->used.load(std::memory_order_relaxed)
+                    && record->used.compare_exchange_strong(
+                        used, true, std::memory_order_acquire)) {
+                    return record;
+                }
+            }
+            auto record = new Record;
+            record->next = records.load(std::memory_order_relaxed);
+            while (!records.compare_exchange_weak(
+                record->next, record, std::memory_order_release,
+                std::memory_order_relaxed)) {
+            }
+            return record;
+        }
+
+        struct Local {
+            Record* record = nullptr;
+
+            ~Local() {
+                if (record) {
+                    record->used.store(false, std::memory_order_release);
+                }
+            }
+        };
+
+        thread_local Local local;
+
+        Record& self() {
+            if (!local.record) {
+                local.record = acquire_record();
+            }
+            return *local.record;
+        }
+    }  // namespace
+
+    detail::Epoch::Guard::Guard() {
+        auto& record = self();
+        if (record.depth++ != 0) {
+            return;
+        }
+        // Закрепление должно стать видно раньше, чем поток прочитает
+        // хоть один указатель, поэтому seq_cst и повторная проверка.
+        auto epoch = global_epoch.load(std::memory_order_seq_cst);
+        while (true) {
+            record.pinned.store(epoch, std::memory_order_seq_cst);
+            auto now = global_epoch.load(std::memory_order_seq_cst);
+            if (now == epoch) {
+                break;
+            }
+            epoch = now;
+        }
+    }
+
+    detail::Epoch::Guard::~Guard() {
+        auto& record = *local.record;
+        if (--record.depth == 0) {
+            record.pinned.store(0, std::memory_order_release);
+        }
+    }
+
+    std::uint64_t detail::Epoch::current() {
+        return global_epoch.load(std::memory_order_seq_cst);
+    }
+
+    std::uint64_t detail::Epoch::advance() {
+        auto epoch = global_epoch.load(std::memory_order_seq_cst);
+        for (auto record = records.load(std::memory_order_acquire); record;
+             record = record->next) {
+            auto pinned = record->pinned.load(std::memory_order_seq_cst);
+            if (pinned != 0 && pinned != epoch) {
+                return epoch;
+            }
+        }
+        global_epoch.compare_exchange_strong(
+            epoch, epoch + 1, std::memory_order_seq_cst);
+        return global_epoch.load(std::memory_order_seq_cst);
+    }
+
+}  // namespace treeset
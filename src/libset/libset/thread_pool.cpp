@@ -0,0 +1,130 @@
+#include <deque>
+#include <libset/thread_pool.hpp>
+
+namespace treeset {
+
+    struct ThreadPool::Queue {
+        std::mutex mutex;
+        std::deque<Job*> jobs;
+    };
+
+    namespace {
+        struct Current {
+            const ThreadPool* pool;
+            std::size_t index;
+        };
+
+        thread_local Current current{nullptr, 0};
+    }  // namespace
+
+    ThreadPool::ThreadPool(std::size_t threads) : pending_(0), stop_(false) {
+        for (std::size_t i = 0; i <= threads; i++) {
+            queues_.push_back(std::make_unique<Queue>());
+        }
+        for (std::size_t i = 0; i < threads; i++) {
+            workers_.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    std::size_t ThreadPool::size() const {
+        return workers_.size();
+    }
+
+    ThreadPool& ThreadPool::global() {
+        static ThreadPool pool([] {
+            auto threads = std::thread::hardware_concurrency();
+            return threads > 1 ? threads - 1 : 0;
+        }());
+        return pool;
+    }
+
+    std::size_t ThreadPool::self() const {
+        return current.pool == this ? current.index : workers_.size();
+    }
+
+    void ThreadPool::push(Job* job) {
+        auto& queue = *queues_[self()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(job);
+        }
+        pending_.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+        }
+        wake_.notify_one();
+    }
+
+    // Своя очередь разбирается с конца (последняя отложенная задача
+    // обычно та, которую ждем), чужие — с начала, где лежат крупные.
+    ThreadPool::Job* ThreadPool::pop(std::size_t index) {
+        {
+            auto& queue = *queues_[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty()) {
+                auto job = queue.jobs.back();
+                queue.jobs.pop_back();
+                pending_.fetch_sub(1);
+                return job;
+            }
+        }
+        for (std::size_t i = 1; i < queues_.size(); i++) {
+            auto& queue = *queues_[(index + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.jobs.empty()) {
+                auto job = queue.jobs.front();
+                queue.jobs.pop_front();
+                pending_.fetch_sub(1);
+                return job;
+            }
+        }
+        return nullptr;
+    }
+
+    void ThreadPool::execute(Job* job) {
+        try {
+            job->run(job->data);
+        } catch (...) {
+            job->error = std::current_exception();
+        }
+        job->done.store(true, std::memory_order_release);
+    }
+
+    void ThreadPool::wait(Job* job) {
+        auto index = self();
+        while (!job->done.load(std::memory_order_acquire)) {
+            if (auto other = pop(index)) {
+                execute(other);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void ThreadPool::work(std::size_t index) {
+        current = Current{this, index};
+        while (true) {
+            if (auto job = pop(index)) {
+                execute(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            wake_.wait(lock, [this] { return stop_ || pending_ > 0; });
+            if (stop_) {
+                return;
+            }
+        }
+    }
+
+}  // namespace treeset
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <type_traits>
+
+namespace tests {
+
+    // Число вызовов allocate у всех CountingAllocator; тесты обнуляют
+    // его перед проверяемым участком.
+    inline std::size_t allocations = 0;
+
+    template <typename T>
+    struct CountingAllocator {
+        using value_type = T;
+
+        CountingAllocator() = default;
+
+        template <typename U>
+        CountingAllocator(const CountingAllocator<U>&) {
+        }
+
+        T* allocate(std::size_t n) {
+            ++allocations;
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T* p, std::size_t n) {
+            std::allocator<T>().deallocate(p, n);
+        }
+
+        template <typename U>
+        bool operator==(const CountingAllocator<U>&) const {
+            return true;
+        }
+    };
+
+    // Аллокатор с состоянием: учитывает живые выделения по номеру арены,
+    // поэтому освобождение чужой памяти уводит счётчик в минус.
+    inline std::map<int, long> arena_live;
+
+    template <typename T>
+    struct ArenaAllocator {
+        using value_type = T;
+        using propagate_on_container_move_assignment = std::false_type;
+
+        int arena;
+
+        explicit ArenaAllocator(int arena_) : arena(arena_) {
+        }
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {
+        }
+
+        T* allocate(std::size_t n) {
+            ++arena_live[arena];
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T* p, std::size_t n) {
+            --arena_live[arena];
+            std::allocator<T>().deallocate(p, n);
+        }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>& other) const {
+            return arena == other.arena;
+        }
+    };
+
+}  // namespace tests
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <libset/btree_set.hpp>
+#include <random>
+#include <set>
+#include <string>
+#include <tests/allocators.hpp>
+#include <vector>
+
+TEST(TestBTreeSet, insertErase) {
+    treeset::BTreeSet<int> set;
+    for (int i = 0; i < 10000; i++) {
+        ASSERT_TRUE(set.insert((i * 7919) % 10000).second);
+    }
+    ASSERT_FALSE(set.insert(42).second);
+    ASSERT_EQ(*set.insert(42).first, 42);
+    ASSERT_EQ(set.size(), 10000);
+    ASSERT_EQ(*set.begin(), 0);
+    ASSERT_EQ(*set.max(), 9999);
+
+    int expected = 0;
+    for (auto key : set) {
+        ASSERT_EQ(key, expected++);
+    }
+
+    for (int i = 0; i < 10000; i += 2) {
+        ASSERT_EQ(set.erase(i), 1);
+    }
+    ASSERT_EQ(set.erase(0), 0);
+    ASSERT_EQ(set.size(), 5000);
+    ASSERT_FALSE(set.contains(100));
+    ASSERT_TRUE(set.contains(101));
+
+    for (int i = 1; i < 10000; i += 2) {
+        set.erase(i);
+    }
+    ASSERT_TRUE(set.empty());
+    ASSERT_EQ(set.begin(), set.end());
+}
+
+TEST(TestBTreeSet, matchesStdSet) {
+    std::mt19937 rng(11);
+    treeset::BTreeSet<int> set;
+    std::set<int> expected;
+    for (int step = 0; step < 50000; step++) {
+        int key = int(rng() % 3000);
+        if (rng() % 2 == 0) {
+            ASSERT_EQ(set.erase(key), expected.erase(key));
+        } else {
+            ASSERT_EQ(set.insert(key).second, expected.insert(key).second);
+        }
+    }
+    ASSERT_EQ(set.size(), expected.size());
+    ASSERT_TRUE(
+        std::equal(set.begin(), set.end(), expected.begin(), expected.end()));
+
+    auto iter = set.end();
+    for (auto key = expected.rbegin(); key != expected.rend(); ++key) {
+        ASSERT_EQ(*--iter, *key);
+    }
+    ASSERT_EQ(iter, set.begin());
+
+    for (int key = -1; key < 3001; key += 7) {
+        auto lower = expected.lower_bound(key);
+        auto upper = expected.upper_bound(key);
+        ASSERT_EQ(
+            set.lower_bound(key) == set.end(), lower == expected.end());
+        if (lower != expected.end()) {
+            ASSERT_EQ(*set.lower_bound(key), *lower);
+        }
+        if (upper != expected.end()) {
+            ASSERT_EQ(*set.upper_bound(key), *upper);
+        }
+        ASSERT_EQ(set.count(key), expected.count(key));
+    }
+}
+
+TEST(TestBTreeSet, copyAndRange) {
+    treeset::BTreeSet<std::string> set;
+    for (int i = 0; i < 500; i++) {
+        set.emplace(std::to_string(i));
+    }
+
+    auto copy = set;
+    set.clear();
+    ASSERT_EQ(copy.size(), 500);
+    ASSERT_TRUE(copy.contains(std::string_view("499")));
+    ASSERT_EQ(*copy.find("250"), "250");
+
+    std::size_t count = 0;
+    for (const auto& key : copy.range(std::string("1"), std::string("2"))) {
+        ASSERT_EQ(key[0], '1');
+        ++count;
+    }
+    ASSERT_EQ(count, 111);
+
+    auto moved = std::move(copy);
+    ASSERT_TRUE(copy.empty());
+    ASSERT_EQ(moved.size(), 500);
+
+    treeset::BTreeSet<int, std::greater<>> descending{1, 5, 3};
+    ASSERT_EQ(*descending.begin(), 5);
+}
+
+TEST(TestBTreeSet, emplaceKeyDiffersFromArguments) {
+    treeset::BTreeSet<std::string> set = {"aba", "abb", "abz"};
+
+    auto res = set.emplace("abc", std::size_t(2));
+    ASSERT_TRUE(res.second);
+    ASSERT_EQ(*res.first, "ab");
+    ASSERT_TRUE(std::is_sorted(set.begin(), set.end()));
+
+    res = set.try_emplace(std::string_view("abb"));
+    ASSERT_FALSE(res.second);
+    ASSERT_EQ(set.size(), 4);
+}
+
+TEST(TestBTreeSet, assignUnequalAllocators) {
+    using ArenaSet = treeset::BTreeSet<
+        std::string, std::less<>, tests::ArenaAllocator<std::string>>;
+    {
+        ArenaSet set(std::less<>(), tests::ArenaAllocator<std::string>(1));
+        ArenaSet other(std::less<>(), tests::ArenaAllocator<std::string>(2));
+        for (int i = 0; i < 1000; i++) {
+            other.insert("key " + std::to_string(i));
+        }
+        set.insert("old");
+
+        set = other;
+        ASSERT_EQ(set.get_allocator().arena, 1);
+        ASSERT_EQ(set.size(), 1000);
+        ASSERT_TRUE(
+            std::equal(set.begin(), set.end(), other.begin(), other.end()));
+
+        set = std::move(other);
+        ASSERT_EQ(set.get_allocator().arena, 1);
+        ASSERT_TRUE(other.empty());
+        ASSERT_EQ(set.size(), 1000);
+        ASSERT_EQ(*set.begin(), "key 0");
+        ASSERT_TRUE(set.contains(std::string_view("key 999")));
+        ASSERT_TRUE(std::is_sorted(set.begin(), set.end()));
+        other.insert("new");
+        set.erase("key 0");
+    }
+    ASSERT_EQ(tests::arena_live[1], 0);
+    ASSERT_EQ(tests::arena_live[2], 0);
+}
@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <libset/compact_set.hpp>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+    // Сверяет дерево с эталоном обходом в обе стороны и соседями каждого
+    // ключа: successor и predecessor идут по ссылкам parent, поэтому
+    // не исправленный после переноса узла индекс здесь проявится.
+    void expect_same(
+        const treeset::CompactSet<int>& set,
+        const std::set<int>& expected) {
+        ASSERT_EQ(set.size(), expected.size());
+        ASSERT_TRUE(std::equal(
+            set.begin(), set.end(), expected.begin(), expected.end()));
+        auto iter = set.end();
+        for (auto key = expected.rbegin(); key != expected.rend(); ++key) {
+            ASSERT_EQ(*--iter, *key);
+        }
+        ASSERT_EQ(iter, set.begin());
+        for (auto key = expected.begin(); key != expected.end(); ++key) {
+            auto pos = set.find(*key);
+            ASSERT_NE(pos, set.end());
+            auto next = std::next(key);
+            ASSERT_EQ(std::next(pos) == set.end(), next == expected.end());
+            if (next != expected.end()) {
+                ASSERT_EQ(*std::next(pos), *next);
+            }
+            if (key != expected.begin()) {
+                ASSERT_EQ(*std::prev(pos), *std::prev(key));
+            }
+        }
+    }
+}  // namespace
+
+// Цвет живёт в старшем бите parent: узел не растёт, а на индекс
+// остаётся 31 бит.
+TEST(TestCompactSet, layout) {
+    static_assert(sizeof(treeset::detail::IndexNode<int>) == 16);
+    static_assert(
+        treeset::CompactSet<int>::max_nodes == (std::size_t(1) << 31) - 1);
+
+    // красные и чёрные узлы вперемешку на всех уровнях
+    treeset::CompactSet<int> set;
+    std::set<int> expected;
+    for (int i = 0; i < 1000; i++) {
+        set.insert(i);
+        expected.insert(i);
+    }
+    for (int i = 999; i >= 0; i -= 3) {
+        set.insert(-i);
+        expected.insert(-i);
+    }
+    ASSERT_NO_FATAL_FAILURE(expect_same(set, expected));
+}
+
+TEST(TestCompactSet, eraseMovesLastNode) {
+    treeset::CompactSet<int> set;
+    std::set<int> expected;
+    for (int i = 0; i < 200; i++) {
+        int key = (i * 37) % 200;
+        set.insert(key);
+        expected.insert(key);
+    }
+
+    // Каждый ключ удаляется из своей копии: среди них корень, сам
+    // последний узел массива, его родитель и дети, чьи ссылки после
+    // переноса указывают на новый слот.
+    for (int key : expected) {
+        auto copy = set;
+        auto rest = expected;
+        ASSERT_EQ(copy.erase(key), 1);
+        rest.erase(key);
+        ASSERT_NO_FATAL_FAILURE(expect_same(copy, rest));
+        copy.insert(key);
+        ASSERT_NO_FATAL_FAILURE(expect_same(copy, expected));
+    }
+
+    while (!expected.empty()) {
+        auto key = *std::next(expected.begin(), expected.size() / 2);
+        ASSERT_EQ(set.erase(key), 1);
+        expected.erase(key);
+        ASSERT_NO_FATAL_FAILURE(expect_same(set, expected));
+    }
+    ASSERT_EQ(set.begin(), set.end());
+}
+
+TEST(TestCompactSet, mixedEraseMatchesStdSet) {
+    for (unsigned seed : {1u, 13u, 29u}) {
+        std::mt19937 rng(seed);
+        treeset::CompactSet<int> set;
+        std::set<int> expected;
+        for (int step = 0; step < 20000; step++) {
+            int key = int(rng() % 500);
+            if (rng() % 3 == 0) {
+                ASSERT_EQ(
+                    set.insert(key).second, expected.insert(key).second);
+            } else {
+                ASSERT_EQ(set.erase(key), expected.erase(key));
+            }
+            if (step % 997 == 0) {
+                ASSERT_NO_FATAL_FAILURE(expect_same(set, expected));
+            }
+            if (step % 4000 == 3999) {
+                for (int i = 0; i < 500; i += 2) {
+                    set.insert(i);
+                    expected.insert(i);
+                }
+            }
+        }
+        ASSERT_NO_FATAL_FAILURE(expect_same(set, expected));
+
+        for (int key = -1; key < 501; key += 7) {
+            auto lower = expected.lower_bound(key);
+            auto upper = expected.upper_bound(key);
+            ASSERT_EQ(
+                set.lower_bound(key) == set.end(), lower == expected.end());
+            if (lower != expected.end()) {
+                ASSERT_EQ(*set.lower_bound(key), *lower);
+            }
+            if (upper != expected.end()) {
+                ASSERT_EQ(*set.upper_bound(key), *upper);
+            }
+        }
+    }
+}
+
+TEST(TestCompactSet, iteratorInvalidation) {
+    treeset::CompactSet<int> set;
+    for (int i = 1; i <= 10; i++) {
+        set.insert(i);
+    }
+
+    // insert сохраняет итераторы, даже когда вектор узлов переезжает
+    std::vector<treeset::CompactSet<int>::iterator> iters;
+    for (auto iter = set.begin(); iter != set.end(); ++iter) {
+        iters.push_back(iter);
+    }
+    for (int i = 11; i <= 1000; i++) {
+        set.insert(i);
+    }
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQ(*iters[i], i + 1);
+    }
+
+    // erase переносит последний вставленный узел в слот удалённого:
+    // старый итератор на него указывает уже на другой ключ
+    auto erased = set.find(3);
+    ASSERT_EQ(set.erase(3), 1);
+    ASSERT_EQ(*erased, 1000);
+    ASSERT_EQ(*set.find(1000), 1000);
+    ASSERT_EQ(*std::next(set.find(2)), 4);
+}
+
+TEST(TestCompactSet, copyIsIndependent) {
+    treeset::CompactSet<std::string> set;
+    for (int i = 0; i < 500; i++) {
+        set.emplace(std::to_string(i));
+    }
+
+    auto copy = set;
+    for (int i = 0; i < 500; i += 2) {
+        set.erase(std::to_string(i));
+    }
+    ASSERT_EQ(set.size(), 250);
+    ASSERT_EQ(copy.size(), 500);
+    ASSERT_TRUE(copy.contains(std::string_view("498")));
+    ASSERT_EQ(*copy.find("250"), "250");
+
+    std::size_t count = 0;
+    for (const auto& key : copy.range(std::string("1"), std::string("2"))) {
+        ASSERT_EQ(key[0], '1');
+        ++count;
+    }
+    ASSERT_EQ(count, 111);
+
+    auto moved = std::move(copy);
+    ASSERT_TRUE(copy.empty());
+    ASSERT_EQ(moved.size(), 500);
+
+    treeset::CompactSet<int, std::greater<>> descending{1, 5, 3};
+    ASSERT_EQ(*descending.begin(), 5);
+}
+
+TEST(TestCompactSet, emplaceKeyDiffersFromArguments) {
+    treeset::CompactSet<std::string> set = {"aba", "abb", "abz"};
+
+    auto res = set.emplace("abc", std::size_t(2));
+    ASSERT_TRUE(res.second);
+    ASSERT_EQ(*res.first, "ab");
+    ASSERT_TRUE(std::is_sorted(set.begin(), set.end()));
+
+    res = set.try_emplace(std::string_view("abb"));
+    ASSERT_FALSE(res.second);
+    ASSERT_EQ(set.size(), 4);
+}
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <libset/concurrent_set.hpp>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(TestConcurrentSet, matchesStdSet) {
+    std::mt19937 rng(3);
+    treeset::ConcurrentSet<int> set;
+    std::set<int> expected;
+    for (int step = 0; step < 50000; step++) {
+        int key = int(rng() % 3000);
+        switch (rng() % 3) {
+            case 0:
+                ASSERT_EQ(set.erase(key), expected.erase(key));
+                break;
+            case 1:
+                ASSERT_EQ(set.insert(key), expected.insert(key).second);
+                break;
+            default:
+                ASSERT_EQ(set.contains(key), expected.count(key) == 1);
+        }
+    }
+    ASSERT_EQ(set.size(), expected.size());
+
+    std::vector<int> keys;
+    set.for_each([&](int key) { keys.push_back(key); });
+    ASSERT_TRUE(
+        std::equal(keys.begin(), keys.end(), expected.begin(), expected.end()));
+
+    keys.clear();
+    set.for_each(100, 200, [&](int key) { keys.push_back(key); });
+    ASSERT_TRUE(std::equal(
+        keys.begin(), keys.end(), expected.lower_bound(100),
+        expected.lower_bound(200)));
+}
+
+TEST(TestConcurrentSet, strings) {
+    treeset::ConcurrentSet<std::string> set{"pear", "apple", "fig"};
+    ASSERT_FALSE(set.insert("fig"));
+    ASSERT_TRUE(set.emplace(3, 'z'));
+    ASSERT_FALSE(set.emplace("zzz"));
+    ASSERT_EQ(set.size(), 4);
+    ASSERT_TRUE(set.contains(std::string_view("pear")));
+    ASSERT_EQ(set.erase(std::string_view("apple")), 1);
+    ASSERT_EQ(set.erase("apple"), 0);
+
+    std::string joined;
+    set.for_each([&](const std::string& key) { joined += key; });
+    ASSERT_EQ(joined, "figpearzzz");
+}
+
+TEST(TestConcurrentSet, stress) {
+    const int threads = 16;
+    const int owned = 2000;
+    const int shared = 64;
+    treeset::ConcurrentSet<int> set;
+    // Сальдо успешных вставок и удалений общих ключей.
+    std::vector<std::atomic<int>> balance(shared);
+    std::vector<std::set<int>> expected(threads);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            for (int step = 0; step < 20000; step++) {
+                auto op = rng() % 4;
+                if (step % 2 == 0) {
+                    // ключи вида k * threads + t принадлежат только потоку t
+                    int key = shared + int(rng() % owned) * threads + t;
+                    if (op == 0) {
+                        ASSERT_EQ(set.erase(key), expected[t].erase(key));
+                    } else if (op == 1) {
+                        ASSERT_EQ(
+                            set.insert(key), expected[t].insert(key).second);
+                    } else {
+                        ASSERT_EQ(
+                            set.contains(key), expected[t].count(key) == 1);
+                    }
+                } else {
+                    int key = int(rng() % shared);
+                    if (op == 0 && set.erase(key) == 1) {
+                        balance[key]--;
+                    } else if (op == 1 && set.insert(key)) {
+                        balance[key]++;
+                    } else {
+                        set.contains(key);
+                    }
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::set<int> all;
+    for (int key = 0; key < shared; key++) {
+        ASSERT_TRUE(balance[key] == 0 || balance[key] == 1);
+        if (balance[key] == 1) {
+            all.insert(key);
+        }
+    }
+    for (auto& keys : expected) {
+        all.insert(keys.begin(), keys.end());
+    }
+    std::vector<int> keys;
+    set.for_each([&](int key) { keys.push_back(key); });
+    ASSERT_EQ(set.size(), all.size());
+    ASSERT_TRUE(std::equal(keys.begin(), keys.end(), all.begin(), all.end()));
+}
+
+TEST(TestConcurrentSet, readersDuringWrites) {
+    treeset::ConcurrentSet<int> set;
+    // нечётные ключи не меняются, чётные вставляются и удаляются
+    for (int key = 1; key < 2000; key += 2) {
+        set.insert(key);
+    }
+
+    std::atomic<bool> done(false);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            for (int step = 0; step < 20000; step++) {
+                int key = int(rng() % 1000) * 2;
+                if (rng() % 2 == 0) {
+                    set.insert(key);
+                } else {
+                    set.erase(key);
+                }
+            }
+        });
+    }
+    for (int t = 0; t < 4; t++) {
+        workers.emplace_back([&] {
+            while (!done.load()) {
+                int last = -1;
+                int odd = 0;
+                set.for_each(500, 1500, [&](int key) {
+                    ASSERT_LT(last, key);
+                    last = key;
+                    odd += key % 2;
+                });
+                ASSERT_EQ(odd, 500);
+                ASSERT_TRUE(set.contains(777));
+            }
+        });
+    }
+    for (int t = 0; t < 4; t++) {
+        workers[t].join();
+    }
+    done.store(true);
+    for (int t = 4; t < 8; t++) {
+        workers[t].join();
+    }
+}
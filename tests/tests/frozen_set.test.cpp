@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <libset/frozen_set.hpp>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+TEST(TestFrozenSet, freezeMatchesSet) {
+    std::mt19937 rng(5);
+    for (int n : {0, 1, 2, 3, 7, 8, 100, 1000, 4097}) {
+        treeset::Set<int> set;
+        std::set<int> expected;
+        while (int(expected.size()) < n) {
+            int key = int(rng() % 20000);
+            set.insert(key);
+            expected.insert(key);
+        }
+
+        auto frozen = set.freeze();
+        ASSERT_EQ(frozen.size(), expected.size());
+        ASSERT_TRUE(std::equal(
+            frozen.begin(), frozen.end(), expected.begin(), expected.end()));
+
+        auto iter = frozen.end();
+        for (auto key = expected.rbegin(); key != expected.rend(); ++key) {
+            ASSERT_EQ(*--iter, *key);
+        }
+        ASSERT_EQ(iter, frozen.begin());
+
+        for (int key = -1; key < 20001; key += 13) {
+            auto lower = expected.lower_bound(key);
+            auto upper = expected.upper_bound(key);
+            ASSERT_EQ(frozen.contains(key), expected.count(key) == 1);
+            ASSERT_EQ(
+                frozen.lower_bound(key) == frozen.end(),
+                lower == expected.end());
+            if (lower != expected.end()) {
+                ASSERT_EQ(*frozen.lower_bound(key), *lower);
+            }
+            if (upper != expected.end()) {
+                ASSERT_EQ(*frozen.upper_bound(key), *upper);
+            }
+            ASSERT_EQ(
+                frozen.rank(key),
+                std::size_t(std::distance(expected.begin(), lower)));
+        }
+    }
+}
+
+TEST(TestFrozenSet, batchContains) {
+    treeset::FrozenSet<long> frozen;
+    ASSERT_FALSE(frozen.contains(1));
+
+    std::vector<long> keys;
+    for (long i = 0; i < 1000; i++) {
+        keys.push_back(i * 3);
+    }
+    frozen = treeset::FrozenSet<long>(keys.rbegin(), keys.rend());
+    ASSERT_EQ(frozen.size(), 1000);
+
+    std::vector<long> queries;
+    for (long i = -5; i < 3010; i++) {
+        queries.push_back(i);
+    }
+    std::vector<bool> found;
+    frozen.contains(
+        queries.begin(), queries.end(), std::back_inserter(found));
+    ASSERT_EQ(found.size(), queries.size());
+    for (std::size_t i = 0; i < queries.size(); i++) {
+        ASSERT_EQ(found[i], frozen.contains(queries[i]));
+    }
+}
+
+TEST(TestFrozenSet, strings) {
+    treeset::FrozenSet<std::string> frozen{"pear", "apple", "fig", "apple"};
+    ASSERT_EQ(frozen.size(), 3);
+    ASSERT_EQ(*frozen.begin(), "apple");
+    ASSERT_EQ(*frozen.max(), "pear");
+    ASSERT_TRUE(frozen.contains(std::string_view("fig")));
+    ASSERT_EQ(frozen.find("kiwi"), frozen.end());
+    ASSERT_EQ(frozen.rank(frozen.find("pear")), 2);
+
+    std::size_t count = 0;
+    for (const auto& key : frozen.range(std::string("b"), std::string("q"))) {
+        ASSERT_NE(key, "apple");
+        ++count;
+    }
+    ASSERT_EQ(count, 2);
+}
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include <libset/int_set.hpp>
+#include <limits>
+#include <ranges>
+#include <random>
+#include <set>
+#include <tests/allocators.hpp>
+#include <vector>
+
+TEST(TestIntSet, matchesStdSet) {
+    std::mt19937 rng(17);
+    treeset::IntSet<std::uint32_t> set;
+    std::set<std::uint32_t> expected;
+    for (int step = 0; step < 100000; step++) {
+        // половина ключей плотная, половина разбросана по всему диапазону
+        auto key =
+            step % 2 ? std::uint32_t(rng() % 5000) : std::uint32_t(rng());
+        switch (rng() % 3) {
+            case 0:
+                ASSERT_EQ(set.erase(key), expected.erase(key));
+                break;
+            case 1:
+                ASSERT_EQ(set.insert(key).second, expected.insert(key).second);
+                break;
+            default:
+                ASSERT_EQ(set.contains(key), expected.count(key) == 1);
+        }
+    }
+    ASSERT_EQ(set.size(), expected.size());
+    ASSERT_TRUE(
+        std::equal(set.begin(), set.end(), expected.begin(), expected.end()));
+
+    auto iter = set.end();
+    for (auto key = expected.rbegin(); key != expected.rend(); ++key) {
+        ASSERT_EQ(*--iter, *key);
+    }
+    ASSERT_EQ(iter, set.begin());
+
+    for (int i = 0; i < 2000; i++) {
+        auto key = i % 2 ? std::uint32_t(rng() % 6000) : std::uint32_t(rng());
+        auto lower = expected.lower_bound(key);
+        auto upper = expected.upper_bound(key);
+        ASSERT_EQ(set.lower_bound(key) == set.end(), lower == expected.end());
+        if (lower != expected.end()) {
+            ASSERT_EQ(*set.lower_bound(key), *lower);
+        }
+        if (upper != expected.end()) {
+            ASSERT_EQ(*set.upper_bound(key), *upper);
+        }
+        if (upper != expected.begin()) {
+            ASSERT_EQ(*set.floor(key), *std::prev(upper));
+        } else {
+            ASSERT_EQ(set.floor(key), set.end());
+        }
+    }
+
+    auto view = set.range(1000u, 4000u);
+    ASSERT_TRUE(std::equal(
+        view.begin(), view.end(), expected.lower_bound(1000),
+        expected.lower_bound(4000)));
+}
+
+TEST(TestIntSet, extremeKeys) {
+    const auto top = std::numeric_limits<std::uint64_t>::max();
+    treeset::IntSet<std::uint64_t> set{top, 0, top - 1, std::uint64_t(1) << 63};
+    ASSERT_EQ(set.size(), 4);
+    ASSERT_EQ(*set.begin(), 0);
+    ASSERT_EQ(*set.max(), top);
+    ASSERT_EQ(std::vector<std::uint64_t>(set.begin(), set.end()),
+              (std::vector<std::uint64_t>{
+                  0, std::uint64_t(1) << 63, top - 1, top}));
+    ASSERT_EQ(set.upper_bound(top), set.end());
+    ASSERT_EQ(*set.lower_bound(1), std::uint64_t(1) << 63);
+    ASSERT_EQ(*set.floor(top - 2), std::uint64_t(1) << 63);
+
+    auto copy = set;
+    ASSERT_EQ(*set.erase(set.find(0)), std::uint64_t(1) << 63);
+    ASSERT_EQ(set.erase(top), 1);
+    ASSERT_EQ(set.size(), 2);
+    ASSERT_EQ(copy.size(), 4);
+    ASSERT_TRUE(copy.contains(0));
+
+    treeset::IntSet<std::uint8_t> bytes;
+    for (int key = 0; key < 256; key += 3) {
+        bytes.insert(std::uint8_t(key));
+    }
+    ASSERT_EQ(bytes.size(), 86);
+    ASSERT_EQ(*bytes.max(), 255);
+    int expected = 0;
+    for (auto key : bytes) {
+        ASSERT_EQ(key, expected);
+        expected += 3;
+    }
+    for (int key = 0; key < 256; key++) {
+        bytes.erase(std::uint8_t(key));
+    }
+    ASSERT_TRUE(bytes.empty());
+    ASSERT_EQ(bytes.begin(), bytes.end());
+}
+
+TEST(TestIntSet, reverseIteration) {
+    treeset::IntSet<std::uint32_t> set{7, 3, 100000, 64, 0};
+    const std::vector<std::uint32_t> expected{100000, 64, 7, 3, 0};
+
+    // reverse_iterator разыменовывает временную копию итератора
+    std::vector<std::uint32_t> keys(
+        std::make_reverse_iterator(set.end()),
+        std::make_reverse_iterator(set.begin()));
+    ASSERT_EQ(keys, expected);
+    ASSERT_EQ(*std::make_reverse_iterator(set.end()), 100000);
+
+    static_assert(std::ranges::bidirectional_range<decltype(set)>);
+    keys.clear();
+    for (auto key : set | std::views::reverse) {
+        keys.push_back(key);
+    }
+    ASSERT_EQ(keys, expected);
+    ASSERT_TRUE(std::ranges::equal(
+        set.range(3u, 65u) | std::views::reverse,
+        std::vector<std::uint32_t>{64, 7, 3}));
+}
+
+TEST(TestIntSet, assignUnequalAllocators) {
+    using ArenaSet =
+        treeset::IntSet<std::uint32_t, tests::ArenaAllocator<std::uint32_t>>;
+    {
+        ArenaSet set(tests::ArenaAllocator<std::uint32_t>(1));
+        ArenaSet other(tests::ArenaAllocator<std::uint32_t>(2));
+        for (std::uint32_t key = 0; key < 5000; key += 3) {
+            other.insert(key * 7919);
+        }
+        set.insert(1);
+
+        set = other;
+        ASSERT_EQ(set.get_allocator().arena, 1);
+        ASSERT_EQ(set.size(), other.size());
+        ASSERT_TRUE(
+            std::equal(set.begin(), set.end(), other.begin(), other.end()));
+
+        // ни один узел не переходит в чужую арену
+        set = std::move(other);
+        ASSERT_EQ(set.get_allocator().arena, 1);
+        ASSERT_TRUE(other.empty());
+        ASSERT_EQ(set.size(), 1667);
+        ASSERT_TRUE(set.contains(4998 * 7919u));
+        other.insert(5);
+        set.erase(0);
+        ASSERT_EQ(*set.begin(), 3 * 7919u);
+    }
+    ASSERT_EQ(tests::arena_live[1], 0);
+    ASSERT_EQ(tests::arena_live[2], 0);
+}
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <libset/persistent_set.hpp>
+#include <random>
+#include <set>
+#include <string>
+#include <tests/allocators.hpp>
+#include <vector>
+
+namespace {
+    using tests::allocations;
+    using tests::CountingAllocator;
+}  // namespace
+
+TEST(TestPersistentSet, snapshots) {
+    treeset::PersistentSet<int> set;
+    for (int i = 0; i < 100; i++) {
+        set.insert(i);
+    }
+
+    auto snapshot = set;
+    set.erase(10);
+    set.insert(1000);
+    ASSERT_EQ(set.size(), 100);
+    ASSERT_EQ(snapshot.size(), 100);
+    ASSERT_FALSE(set.contains(10));
+    ASSERT_TRUE(snapshot.contains(10));
+    ASSERT_TRUE(set.contains(1000));
+    ASSERT_FALSE(snapshot.contains(1000));
+
+    snapshot.clear();
+    ASSERT_TRUE(snapshot.empty());
+    ASSERT_EQ(*set.begin(), 0);
+    ASSERT_EQ(*set.max(), 1000);
+}
+
+TEST(TestPersistentSet, pathCopying) {
+    using CountedSet =
+        treeset::PersistentSet<int, std::less<>, CountingAllocator<int>>;
+    CountedSet set;
+    for (int i = 0; i < 1024; i++) {
+        set.insert(i);
+    }
+
+    allocations = 0;
+    set.insert(5000);
+    ASSERT_EQ(allocations, 1);
+
+    allocations = 0;
+    auto snapshot = set;
+    ASSERT_EQ(allocations, 0);
+    set.insert(-1);
+    ASSERT_LE(allocations, 16);
+    ASSERT_GT(allocations, 1);
+
+    allocations = 0;
+    set.insert(-2);
+    ASSERT_LE(allocations, 4);
+    ASSERT_EQ(snapshot.size(), 1025);
+    ASSERT_EQ(set.size(), 1027);
+}
+
+TEST(TestPersistentSet, matchesStdSet) {
+    std::mt19937 rng(7);
+    treeset::PersistentSet<int> set;
+    std::set<int> expected;
+    std::vector<std::pair<treeset::PersistentSet<int>, std::set<int>>> history;
+    for (int step = 0; step < 5000; step++) {
+        int key = int(rng() % 500);
+        if (rng() % 3 == 0) {
+            ASSERT_EQ(set.erase(key), expected.erase(key));
+        } else {
+            ASSERT_EQ(set.insert(key).second, expected.insert(key).second);
+        }
+        if (step % 500 == 0) {
+            history.emplace_back(set, expected);
+        }
+    }
+    history.emplace_back(set, expected);
+
+    for (const auto& [snapshot, keys] : history) {
+        ASSERT_EQ(snapshot.size(), keys.size());
+        ASSERT_TRUE(std::equal(
+            snapshot.begin(), snapshot.end(), keys.begin(), keys.end()));
+        ASSERT_EQ(
+            std::distance(snapshot.begin(), snapshot.end()),
+            std::ptrdiff_t(keys.size()));
+    }
+}
+
+TEST(TestPersistentSet, iterators) {
+    treeset::PersistentSet<int> set{5, 1, 9, 3, 7};
+
+    auto iter = set.end();
+    --iter;
+    ASSERT_EQ(*iter, 9);
+    ASSERT_EQ(*--iter, 7);
+    ASSERT_EQ(*set.lower_bound(4), 5);
+    ASSERT_EQ(*set.upper_bound(5), 7);
+    ASSERT_EQ(set.lower_bound(10), set.end());
+    ASSERT_EQ(*set.find(3), 3);
+    ASSERT_EQ(set.find(4), set.end());
+
+    auto res = set.insert(4);
+    ASSERT_TRUE(res.second);
+    ASSERT_EQ(*++res.first, 5);
+
+    treeset::PersistentSet<std::string> strings;
+    strings.emplace(3, 'a');
+    ASSERT_TRUE(strings.contains(std::string_view("aaa")));
+}
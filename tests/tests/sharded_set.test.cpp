@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <libset/sharded_set.hpp>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(TestShardedSet, matchesStdSet) {
+    std::mt19937 rng(7);
+    treeset::ShardedSet<int> set(4);
+    std::set<int> expected;
+    for (int step = 0; step < 60000; step++) {
+        int key = int(rng() % 20000);
+        if (rng() % 3 == 0) {
+            ASSERT_EQ(set.erase(key), expected.erase(key));
+        } else {
+            ASSERT_EQ(set.insert(key), expected.insert(key).second);
+        }
+        if (step % 20000 == 0) {
+            set.rebalance();
+        }
+    }
+    ASSERT_EQ(set.size(), expected.size());
+    ASSERT_TRUE(
+        std::equal(set.begin(), set.end(), expected.begin(), expected.end()));
+
+    std::vector<int> keys;
+    set.for_each(5000, 15000, [&](int key) { keys.push_back(key); });
+    ASSERT_TRUE(std::equal(
+        keys.begin(), keys.end(), expected.lower_bound(5000),
+        expected.lower_bound(15000)));
+    auto view = set.range(5000, 15000);
+    ASSERT_TRUE(
+        std::equal(view.begin(), view.end(), keys.begin(), keys.end()));
+    for (int key = -1; key < 20001; key += 37) {
+        ASSERT_EQ(set.contains(key), expected.count(key) == 1);
+    }
+}
+
+TEST(TestShardedSet, rebalancesSkew) {
+    treeset::ShardedSet<int> set(4);
+    // возрастающие ключи всё время попадают в последнюю часть
+    for (int key = 0; key < 40000; key++) {
+        set.insert(key);
+    }
+    for (std::size_t i = 0; i < set.shard_count(); i++) {
+        ASSERT_LE(set.shard_size(i), 2 * set.size() / set.shard_count() + 1);
+    }
+    int expected = 0;
+    for (auto key : set) {
+        ASSERT_EQ(key, expected++);
+    }
+    ASSERT_EQ(expected, 40000);
+
+    // при двух частях перекос меряется относительно второй части
+    treeset::ShardedSet<int> pair(2);
+    for (int key = 0; key < 100000; key++) {
+        pair.insert(key);
+    }
+    ASSERT_EQ(pair.size(), 100000);
+    for (std::size_t i = 0; i < pair.shard_count(); i++) {
+        ASSERT_LE(pair.shard_size(i), 2 * pair.size() / 3 + 1);
+    }
+
+    treeset::ShardedSet<std::string> empty(3);
+    ASSERT_EQ(empty.begin(), empty.end());
+    ASSERT_TRUE(empty.range(std::string("a"), std::string("z")).empty());
+}
+
+TEST(TestShardedSet, concurrentWriters) {
+    const int threads = 8;
+    const int per_thread = 5000;
+    treeset::ShardedSet<int> set(4);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < per_thread; i++) {
+                int key = i * threads + t;
+                set.insert(key);
+                if (i % 2 == 0) {
+                    set.submit_erase(key);
+                } else {
+                    set.submit_insert(key + threads * per_thread);
+                }
+                set.contains(key / 2);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    // перебалансировка по дороге могла применить часть очередей
+    set.flush();
+    ASSERT_EQ(set.size(), threads * per_thread);
+
+    std::set<int> expected;
+    for (int i = 0; i < per_thread; i++) {
+        for (int t = 0; t < threads; t++) {
+            int key = i * threads + t;
+            if (i % 2 == 1) {
+                expected.insert(key);
+                expected.insert(key + threads * per_thread);
+            }
+        }
+    }
+    ASSERT_TRUE(
+        std::equal(set.begin(), set.end(), expected.begin(), expected.end()));
+}
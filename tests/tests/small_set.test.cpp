@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstddef>
+#include <libset/small_set.hpp>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tests/allocators.hpp>
+#include <vector>
+
+namespace {
+    using tests::allocations;
+    using tests::CountingAllocator;
+}  // namespace
+
+TEST(TestSmallSet, staysInline) {
+    using Small =
+        treeset::SmallSet<int, 8, std::less<>, CountingAllocator<int>>;
+    allocations = 0;
+    Small set{5, 3, 9, 1};
+    ASSERT_TRUE(set.insert(7).second);
+    ASSERT_FALSE(set.insert(3).second);
+    ASSERT_EQ(set.erase(9), 1);
+    ASSERT_EQ(*set.erase(set.find(3)), 5);
+    Small copy(set);
+    Small moved(std::move(copy));
+    ASSERT_EQ(allocations, 0);
+    ASSERT_TRUE(set.is_inline());
+    ASSERT_EQ(std::vector<int>(moved.begin(), moved.end()),
+              (std::vector<int>{1, 5, 7}));
+    ASSERT_EQ(*set.lower_bound(2), 5);
+    ASSERT_EQ(*set.upper_bound(5), 7);
+    ASSERT_EQ(set.upper_bound(7), set.end());
+    ASSERT_EQ(*set.max(), 7);
+    ASSERT_EQ(*--set.end(), 7);
+
+    for (int key = 10; key < 15; key++) {
+        set.insert(key);
+    }
+    ASSERT_EQ(allocations, 0);
+    ASSERT_EQ(set.size(), 8);
+    set.insert(15);
+    ASSERT_FALSE(set.is_inline());
+    ASSERT_GT(allocations, 0);
+    ASSERT_EQ(set.size(), 9);
+    ASSERT_EQ(*set.begin(), 1);
+    ASSERT_EQ(*set.max(), 15);
+    ASSERT_TRUE(set.contains(12));
+
+    set.clear();
+    ASSERT_TRUE(set.is_inline());
+    ASSERT_TRUE(set.empty());
+    ASSERT_EQ(set.begin(), set.end());
+}
+
+TEST(TestSmallSet, matchesStdSet) {
+    std::mt19937 rng(13);
+    for (int round = 0; round < 200; round++) {
+        treeset::SmallSet<int, 16> set;
+        std::set<int> expected;
+        int range = 8 + int(rng() % 40);
+        for (int step = 0; step < 100; step++) {
+            int key = int(rng() % range);
+            if (rng() % 3 == 0) {
+                ASSERT_EQ(set.erase(key), expected.erase(key));
+            } else {
+                ASSERT_EQ(set.insert(key).second, expected.insert(key).second);
+            }
+            ASSERT_EQ(set.contains(key), expected.count(key) == 1);
+        }
+        ASSERT_EQ(set.size(), expected.size());
+        if (range <= 16) {
+            ASSERT_TRUE(set.is_inline());
+        } else if (expected.size() > 16) {
+            ASSERT_FALSE(set.is_inline());
+        }
+        ASSERT_TRUE(std::equal(
+            set.begin(), set.end(), expected.begin(), expected.end()));
+
+        auto view = set.range(range / 4, range / 2);
+        ASSERT_TRUE(std::equal(
+            view.begin(), view.end(), expected.lower_bound(range / 4),
+            expected.lower_bound(range / 2)));
+
+        auto copy = set;
+        for (auto it = copy.begin(); it != copy.end();) {
+            it = *it % 2 == 0 ? copy.erase(it) : std::next(it);
+        }
+        for (auto key : copy) {
+            ASSERT_EQ(key % 2, 1);
+        }
+        set.swap(copy);
+        ASSERT_EQ(copy.size(), expected.size());
+    }
+}
+
+TEST(TestSmallSet, strings) {
+    treeset::SmallSet<std::string, 4> set{"pear", "apple", "fig"};
+    ASSERT_EQ(*set.emplace(3, 'z').first, "zzz");
+    ASSERT_TRUE(set.is_inline());
+    ASSERT_TRUE(set.contains(std::string_view("fig")));
+    ASSERT_TRUE(set.insert("kiwi").second);
+    ASSERT_FALSE(set.is_inline());
+    ASSERT_EQ(set.erase(std::string_view("apple")), 1);
+
+    std::string joined;
+    for (const auto& key : set) {
+        joined += key;
+    }
+    ASSERT_EQ(joined, "figkiwipearzzz");
+
+    treeset::SmallSet<std::string, 4> other{"b", "a"};
+    other = set;
+    ASSERT_EQ(other.size(), 4);
+    set = treeset::SmallSet<std::string, 4>{"c"};
+    ASSERT_TRUE(set.is_inline());
+    ASSERT_EQ(*set.begin(), "c");
+}
+
+TEST(TestSmallSet, emplaceKeyDiffersFromArguments) {
+    treeset::SmallSet<std::string, 4> set{"aba", "abb", "abz"};
+
+    auto res = set.emplace("abc", std::size_t(2));
+    ASSERT_TRUE(res.second);
+    ASSERT_EQ(*res.first, "ab");
+    ASSERT_TRUE(set.is_inline());
+    ASSERT_TRUE(std::is_sorted(set.begin(), set.end()));
+
+    res = set.emplace("aac", std::size_t(2));
+    ASSERT_TRUE(res.second);
+    ASSERT_EQ(*res.first, "aa");
+    ASSERT_FALSE(set.is_inline());
+    ASSERT_TRUE(std::is_sorted(set.begin(), set.end()));
+    ASSERT_EQ(*set.begin(), "aa");
+    ASSERT_EQ(set.size(), 5);
+}
@@ -1,5 +1,37 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
 #include <libset/treeset.hpp>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tests/allocators.hpp>
+#include <type_traits>
+#include <vector>
+
+namespace {
+    using tests::allocations;
+    using tests::arena_live;
+    using tests::ArenaAllocator;
+    using tests::CountingAllocator;
+
+    std::size_t less_calls = 0;
+    std::size_t three_way_calls = 0;
+
+    struct ThreeWayCompare {
+        bool operator()(int lhs, int rhs) const {
+            ++less_calls;
+            return lhs < rhs;
+        }
+
+        std::weak_ordering compare(int lhs, int rhs) const {
+            ++three_way_calls;
+            return lhs <=> rhs;
+        }
+    };
+}  // namespace
 
 TEST(TestNode, compare) {
     treeset::detail::Node<int> node1(10);
@@ -16,6 +48,45 @@ TEST(TestNode, compare) {
     ASSERT_FALSE(node3 > node1);
 }
 
+TEST(TestNode, layout) {
+    using Plain = treeset::detail::Node<int>;
+    using Counted = treeset::detail::Node<int, treeset::order_statistics>;
+
+    ASSERT_EQ(sizeof(Plain), 4 * sizeof(void*));
+    ASSERT_EQ(sizeof(Counted), sizeof(Plain) + sizeof(std::size_t));
+
+    using Wide = treeset::detail::Node<long>;
+    using Compact = treeset::detail::Node<long, treeset::compact_nodes>;
+    ASSERT_EQ(sizeof(Compact), 4 * sizeof(void*));
+    ASSERT_EQ(sizeof(Wide), sizeof(Compact) + sizeof(void*));
+
+    Compact node(7, treeset::RED, &node);
+    ASSERT_EQ(node.parent(), &node);
+    ASSERT_EQ(node.color(), treeset::RED);
+    node.set_color(treeset::BLACK);
+    node.set_parent(nullptr);
+    ASSERT_EQ(node.parent(), nullptr);
+    ASSERT_EQ(node.color(), treeset::BLACK);
+}
+
+TEST(TestNodePool, reserveKeepsLeftover) {
+    using Node = treeset::detail::Node<int>;
+    treeset::detail::NodePool<Node, CountingAllocator<Node>> pool;
+    allocations = 0;
+    std::vector<Node*> nodes{pool.create(1)};
+    ASSERT_EQ(allocations, 1);
+    // остаток первого чанка уходит во freelist, а не теряется
+    pool.reserve(100);
+    ASSERT_EQ(allocations, 2);
+    for (int i = 0; i < 15 + 100; i++) {
+        nodes.push_back(pool.create(i));
+    }
+    ASSERT_EQ(allocations, 2);
+    for (auto node : nodes) {
+        pool.destroy(node);
+    }
+}
+
 TEST(TestSet, constructors) {
     treeset::Set<int> set1;
     treeset::Set<int> set2(10);
@@ -46,6 +117,39 @@ TEST(TestSet, constructors) {
     }
 }
 
+TEST(TestSet, rangeConstructors) {
+    const std::vector<int> unsorted = {5, 3, 9, 3, 1, 7, 5, 0};
+    const std::vector<int> expected_result = {0, 1, 3, 5, 7, 9};
+
+    treeset::Set set(unsorted.begin(), unsorted.end());
+    ASSERT_EQ(set.size(), expected_result.size());
+    int index = 0;
+    for (const auto& setElem : set) {
+        ASSERT_EQ(setElem, expected_result[index]);
+        index++;
+    }
+    ASSERT_EQ(*set.max(), 9);
+
+    std::vector<int> sorted;
+    for (int i = 0; i < 1000; i++) {
+        sorted.push_back(i * 2);
+    }
+    allocations = 0;
+    auto sorted_set = treeset::Set<int, std::less<>, CountingAllocator<int>>::
+        from_sorted(sorted.begin(), sorted.end());
+    ASSERT_EQ(allocations, 2);
+    ASSERT_EQ(sorted_set.size(), 1000);
+    ASSERT_EQ(*sorted_set.begin(), 0);
+    ASSERT_EQ(*sorted_set.max(), 1998);
+    ASSERT_TRUE(sorted_set.contains(1000));
+    ASSERT_FALSE(sorted_set.contains(1001));
+
+    sorted_set.insert(1001);
+    sorted_set.erase(0);
+    ASSERT_EQ(*sorted_set.begin(), 2);
+    ASSERT_EQ(*sorted_set.lower_bound(1001), 1001);
+}
+
 TEST(TestSet, assignments) {
     treeset::Set<int> set1;
 
@@ -89,6 +193,61 @@ TEST(TestSet, insert) {
     }
 }
 
+TEST(TestSet, insertIterator) {
+    treeset::Set<int> set;
+
+    for (int i = 0; i < 100; i++) {
+        auto res = set.insert((i * 37) % 100);
+        ASSERT_TRUE(res.second);
+        ASSERT_EQ(*res.first, (i * 37) % 100);
+    }
+
+    auto res = set.insert(42);
+    ASSERT_FALSE(res.second);
+    ASSERT_EQ(*res.first, 42);
+    ASSERT_EQ(*(++res.first), 43);
+}
+
+TEST(TestSet, emplace) {
+    treeset::Set<std::string> set;
+
+    std::string key = "long enough string to live on the heap";
+    auto res = set.insert(std::move(key));
+    ASSERT_TRUE(res.second);
+    ASSERT_TRUE(key.empty());
+
+    res = set.emplace(5, 'a');
+    ASSERT_TRUE(res.second);
+    ASSERT_EQ(*res.first, "aaaaa");
+    res = set.emplace(5, 'a');
+    ASSERT_FALSE(res.second);
+
+    res = set.try_emplace("bbb");
+    ASSERT_TRUE(res.second);
+    ASSERT_EQ(*res.first, "bbb");
+    res = set.try_emplace("bbb");
+    ASSERT_FALSE(res.second);
+
+    ASSERT_EQ(set.size(), 3);
+    ASSERT_EQ(*set.begin(), "aaaaa");
+}
+
+TEST(TestSet, emplace_key_differs_from_arguments) {
+    treeset::Set<std::string> set = {"aba", "abb", "abz"};
+
+    // std::string("abc", 2) == "ab": место ищется по готовому ключу
+    auto res = set.emplace("abc", std::size_t(2));
+    ASSERT_TRUE(res.second);
+    ASSERT_EQ(*res.first, "ab");
+    ASSERT_TRUE(std::is_sorted(set.begin(), set.end()));
+    ASSERT_EQ(*set.begin(), "ab");
+    ASSERT_TRUE(set.contains("ab"));
+
+    res = set.emplace("abx", std::size_t(2));
+    ASSERT_FALSE(res.second);
+    ASSERT_EQ(set.size(), 4);
+}
+
 TEST(TestSet, erase) {
     treeset::Set<int> set;
 
@@ -203,6 +362,34 @@ TEST(TestSet, find) {
     ASSERT_EQ(res, set.end());
 }
 
+TEST(TestSet, heterogeneousLookup) {
+    treeset::Set<std::string> set{"alpha", "bravo", "charlie"};
+    std::string_view key = "bravo";
+
+    ASSERT_TRUE(set.contains(key));
+    ASSERT_FALSE(set.contains(std::string_view("delta")));
+    ASSERT_EQ(*set.find(key), "bravo");
+    ASSERT_EQ(set.find("delta"), set.end());
+    ASSERT_EQ(set.count("alpha"), 1);
+
+    ASSERT_EQ(set.erase(key), 1);
+    ASSERT_EQ(set.erase(key), 0);
+    ASSERT_EQ(set.size(), 2);
+}
+
+TEST(TestSet, compare) {
+    treeset::Set<int, std::greater<>> set{3, 1, 4, 1, 5, 9, 2, 6};
+    const std::vector<int> expected_result = {9, 6, 5, 4, 3, 2, 1};
+
+    int index = 0;
+    for (const auto& setElem : set) {
+        ASSERT_EQ(setElem, expected_result[index]);
+        index++;
+    }
+    ASSERT_TRUE(set.contains(4));
+    ASSERT_EQ(*set.max(), 1);
+}
+
 TEST(TestSet, lowerBound) {
     treeset::Set<int> set;
     for (int i = 0; i < 10; i++) {
@@ -230,9 +417,54 @@ TEST(TestSet, upperBound) {
     ASSERT_EQ(*iter1, *iter2);
 
     iter2 = set.upper_bound(-100);
+    ASSERT_EQ(iter2, set.begin());
+
+    iter2 = set.upper_bound(9);
     ASSERT_EQ(iter2, set.end());
 }
 
+TEST(TestSet, boundsAbsentKeys) {
+    treeset::Set<int> set;
+    for (int i = 0; i < 20; i += 2) {
+        set.insert(i);
+    }
+
+    ASSERT_EQ(*set.lower_bound(5), 6);
+    ASSERT_EQ(*set.upper_bound(5), 6);
+    ASSERT_EQ(*set.lower_bound(-3), 0);
+    ASSERT_EQ(set.upper_bound(18), set.end());
+
+    auto res = set.equal_range(7);
+    ASSERT_EQ(res.first, res.second);
+    ASSERT_EQ(*res.first, 8);
+}
+
+TEST(TestSet, range) {
+    treeset::Set<int> set;
+    for (int i = 0; i < 100; i += 3) {
+        set.insert(i);
+    }
+
+    const std::vector<int> expected_result = {12, 15, 18};
+    int index = 0;
+    for (const auto& setElem : set.range(10, 20)) {
+        ASSERT_EQ(setElem, expected_result[index]);
+        index++;
+    }
+    ASSERT_EQ(index, 3);
+    ASSERT_TRUE(set.range(13, 14).empty());
+    ASSERT_TRUE(set.range(50, 10).empty());
+
+    ASSERT_EQ(set.count_range(10, 20), 3);
+    ASSERT_EQ(set.count_range(-100, 1000), set.size());
+    ASSERT_EQ(set.count_range(0, 3), 1);
+
+    ASSERT_EQ(set.erase_range(10, 50), 13);
+    ASSERT_EQ(set.count_range(10, 50), 0);
+    ASSERT_EQ(*set.lower_bound(10), 51);
+    ASSERT_EQ(set.size(), 21);
+}
+
 TEST(TestSet, equalRange) {
     treeset::Set<int> set;
     for (int i = 0; i < 10; i++) {
@@ -280,6 +512,644 @@ TEST(TestSet, max) {
     ASSERT_EQ(*max, 9);
 }
 
+TEST(TestSet, allocator) {
+    allocations = 0;
+    treeset::Set<int, std::less<>, CountingAllocator<int>> set;
+
+    for (int i = 0; i < 1000; i++) {
+        set.insert(i);
+    }
+    ASSERT_EQ(set.size(), 1000);
+    ASSERT_LT(allocations, 20);
+
+    for (int i = 0; i < 1000; i += 2) {
+        set.erase(i);
+    }
+    auto before = allocations;
+    for (int i = 0; i < 1000; i += 2) {
+        set.insert(i);
+    }
+    ASSERT_EQ(allocations, before);
+
+    set.clear();
+    ASSERT_TRUE(set.empty());
+    for (int i = 10; i > 0; i--) {
+        set.insert(i);
+    }
+    int expected = 1;
+    for (const auto& sElem : set) {
+        ASSERT_EQ(sElem, expected++);
+    }
+}
+
+TEST(TestSet, moveAssignUnequalAllocators) {
+    using ArenaSet =
+        treeset::Set<std::string, std::less<>, ArenaAllocator<std::string>>;
+    {
+        ArenaSet set(std::less<>(), ArenaAllocator<std::string>(1));
+        ArenaSet other(std::less<>(), ArenaAllocator<std::string>(2));
+        for (int i = 0; i < 100; i++) {
+            set.insert(std::to_string(i));
+            other.insert(std::to_string(i * 2));
+        }
+        set = std::move(other);
+        ASSERT_TRUE(other.empty());
+        ASSERT_EQ(set.size(), 100);
+        ASSERT_EQ(set.get_allocator().arena, 1);
+        ASSERT_EQ(*set.begin(), "0");
+        ASSERT_EQ(*set.max(), "98");
+        set.insert("x");
+        other.insert("y");
+        ASSERT_EQ(other.size(), 1);
+    }
+    ASSERT_EQ(arena_live[1], 0);
+    ASSERT_EQ(arena_live[2], 0);
+}
+
+TEST(TestSet, stringKeys) {
+    treeset::Set<std::string> set{"delta", "alpha", "charlie", "bravo"};
+    auto copy_set = set;
+    set.clear();
+    set.insert("echo");
+
+    ASSERT_EQ(*copy_set.begin(), "alpha");
+    ASSERT_EQ(*copy_set.max(), "delta");
+    ASSERT_TRUE(copy_set.contains("charlie"));
+    ASSERT_EQ(set.size(), 1);
+    ASSERT_EQ(*set.begin(), "echo");
+
+    auto moved_set = std::move(copy_set);
+    moved_set.insert("foxtrot");
+    ASSERT_EQ(*moved_set.max(), "foxtrot");
+}
+
+TEST(TestSet, orderStatistics) {
+    treeset::OrderedSet<int> set;
+    for (int i = 0; i < 100; i++) {
+        set.insert((i * 37) % 100 * 2);
+    }
+    for (int i = 0; i < 100; i += 4) {
+        set.erase(i * 2);
+    }
+
+    ASSERT_EQ(set.size(), 75);
+    ASSERT_EQ(*set.nth(0), 2);
+    ASSERT_EQ(*set.nth(1), 4);
+    ASSERT_EQ(*set.nth(74), 198);
+    ASSERT_EQ(set.nth(75), set.end());
+
+    ASSERT_EQ(set.rank(0), 0);
+    ASSERT_EQ(set.rank(8), 3);
+    ASSERT_EQ(set.rank(9), 3);
+    ASSERT_EQ(set.rank(11), 4);
+    ASSERT_EQ(set.rank(1000), 75);
+    ASSERT_EQ(set.count_range(8, 17), 3);
+
+    auto median = set.begin() + 37;
+    ASSERT_EQ(*median, *set.nth(37));
+    ASSERT_EQ(median - set.begin(), 37);
+    ASSERT_EQ(set.end() - median, 38);
+    median -= 30;
+    ASSERT_EQ(*median, *set.nth(7));
+    ASSERT_EQ(set.begin() + 75, set.end());
+}
+
+TEST(TestSet, compactNodes) {
+    using CompactOrdered = treeset::Set<
+        long,
+        std::less<>,
+        std::allocator<long>,
+        treeset::compact_nodes | treeset::order_statistics>;
+    CompactOrdered set;
+    for (long i = 0; i < 1000; i++) {
+        set.insert((i * 7919) % 1000);
+    }
+    for (long i = 0; i < 1000; i += 3) {
+        set.erase(i);
+    }
+
+    ASSERT_EQ(set.size(), 666);
+    ASSERT_EQ(*set.begin(), 1);
+    ASSERT_EQ(*set.max(), 998);
+    ASSERT_EQ(*set.nth(1), 2);
+    ASSERT_EQ(set.rank(500), 333);
+
+    long previous = 0;
+    for (auto key : set) {
+        ASSERT_LT(previous, key);
+        ASSERT_NE(key % 3, 0);
+        previous = key;
+    }
+
+    CompactOrdered other(set.begin(), set.end());
+    other.union_with(CompactOrdered{0, 3, 6});
+    ASSERT_EQ(other.size(), 669);
+    ASSERT_EQ(*other.begin(), 0);
+}
+
+TEST(TestSet, threaded) {
+    using Threaded = treeset::Set<
+        int,
+        std::less<>,
+        std::allocator<int>,
+        treeset::threaded>;
+    Threaded set;
+    for (int i = 0; i < 1000; i++) {
+        set.insert((i * 7919) % 1000);
+    }
+    for (int i = 0; i < 1000; i += 3) {
+        set.erase(i);
+    }
+    ASSERT_EQ(set.erase_range(500, 600), 67);
+
+    int previous = -1;
+    std::size_t count = 0;
+    for (auto key : set) {
+        ASSERT_LT(previous, key);
+        ASSERT_NE(key % 3, 0);
+        previous = key;
+        ++count;
+    }
+    ASSERT_EQ(count, set.size());
+
+    auto iter = set.end();
+    ASSERT_EQ(*--iter, 998);
+    ASSERT_EQ(*--iter, 997);
+
+    Threaded copy = set;
+    copy.union_with(Threaded{0, 3, 550});
+    ASSERT_EQ(copy.size(), set.size() + 3);
+    ASSERT_EQ(*copy.begin(), 0);
+    ASSERT_EQ(*++copy.begin(), 1);
+    ASSERT_EQ(*--copy.find(550), 499);
+    ASSERT_EQ(*++copy.find(550), 601);
+
+    copy.intersect_with(Threaded{1, 2, 3, 4});
+    ASSERT_EQ(std::vector<int>(copy.begin(), copy.end()),
+              std::vector<int>({1, 2, 3, 4}));
+    copy.clear();
+    ASSERT_EQ(copy.begin(), copy.end());
+}
+
+TEST(TestSet, threeWayCompare) {
+    treeset::Set<int, ThreeWayCompare> set;
+    for (int i = 0; i < 1024; i++) {
+        set.insert(i);
+    }
+
+    less_calls = 0;
+    three_way_calls = 0;
+    ASSERT_TRUE(set.contains(700));
+    ASSERT_FALSE(set.contains(5000));
+    ASSERT_FALSE(set.insert(10).second);
+    ASSERT_EQ(set.erase(11), 1);
+    ASSERT_EQ(less_calls, 0);
+    ASSERT_GT(three_way_calls, 0);
+    ASSERT_LE(three_way_calls, 4 * 2 * 11);
+
+    treeset::Set<std::string, std::greater<>> descending{"a", "c", "b"};
+    ASSERT_EQ(*descending.begin(), "c");
+    ASSERT_TRUE(descending.contains("b"));
+    ASSERT_EQ(descending.erase("a"), 1);
+    ASSERT_EQ(*descending.max(), "b");
+}
+
+TEST(TestSet, hintedInsert) {
+    treeset::Set<int, ThreeWayCompare> set;
+    three_way_calls = 0;
+    for (int i = 0; i < 1000; i++) {
+        set.insert(set.end(), i);
+    }
+    // каждый новый максимум сравнивается только с прежним максимумом
+    ASSERT_EQ(three_way_calls, 999);
+    three_way_calls = 0;
+    for (int i = 1000; i < 2000; i++) {
+        set.insert(i);
+    }
+    ASSERT_EQ(three_way_calls, 1000);
+
+    auto iter = set.insert(set.begin(), -1);
+    ASSERT_EQ(iter, set.begin());
+    ASSERT_EQ(*set.insert(set.find(500), 500), 500);
+    ASSERT_EQ(set.size(), 2001);
+
+    treeset::Set<int, std::less<>, std::allocator<int>,
+                 treeset::order_statistics>
+        gaps;
+    for (int i = 0; i < 100; i += 2) {
+        gaps.insert(i);
+    }
+    for (int i = 1; i < 100; i += 2) {
+        // подсказка — соседний элемент с любой стороны или далёкий
+        auto hint = i % 3 == 0 ? gaps.find(i + 1)
+            : i % 3 == 1       ? gaps.find(i - 1)
+                               : gaps.begin();
+        auto inserted = gaps.insert(hint, i);
+        ASSERT_EQ(*inserted, i);
+        ASSERT_EQ(inserted - gaps.begin(), i);
+    }
+    int expected = 0;
+    for (auto key : gaps) {
+        ASSERT_EQ(key, expected++);
+    }
+    ASSERT_EQ(*gaps.max(), 99);
+
+    treeset::Set<std::string> words{"b", "d"};
+    ASSERT_EQ(*words.emplace_hint(words.find("d"), 1, 'c'), "c");
+    ASSERT_EQ(*words.emplace_hint(words.end(), "e"), "e");
+    ASSERT_EQ(*words.emplace_hint(words.begin(), "a"), "a");
+    ASSERT_EQ(*words.emplace_hint(words.begin(), "c"), "c");
+    ASSERT_EQ(words.size(), 5);
+    ASSERT_EQ(*words.begin(), "a");
+    ASSERT_EQ(*words.max(), "e");
+}
+
+TEST(TestSet, iteratorDistance) {
+    treeset::Set<int> set{5, 6, 4, 7, 3, 8, 2, 9, 1, 0};
+
+    ASSERT_EQ(set.end() - set.begin(), 10);
+    ASSERT_EQ(set.find(7) - set.find(2), 5);
+}
+
+TEST(TestSet, setAlgebra) {
+    treeset::Set<int> set1{1, 2, 3, 4, 5, 6};
+    treeset::Set<int> set2{4, 5, 6, 7, 8};
+
+    const std::vector<int> union_result = {1, 2, 3, 4, 5, 6, 7, 8};
+    const std::vector<int> intersection_result = {4, 5, 6};
+    const std::vector<int> difference_result = {1, 2, 3};
+    const std::vector<int> symmetric_result = {1, 2, 3, 7, 8};
+
+    auto res = treeset::set_union(set1, set2);
+    ASSERT_TRUE(std::equal(
+        res.begin(), res.end(), union_result.begin(), union_result.end()));
+    res = treeset::set_intersection(set1, set2);
+    ASSERT_TRUE(std::equal(
+        res.begin(), res.end(), intersection_result.begin(),
+        intersection_result.end()));
+    res = treeset::set_difference(set1, set2);
+    ASSERT_TRUE(std::equal(
+        res.begin(), res.end(), difference_result.begin(),
+        difference_result.end()));
+    res = treeset::symmetric_difference(set1, set2);
+    ASSERT_TRUE(std::equal(
+        res.begin(), res.end(), symmetric_result.begin(),
+        symmetric_result.end()));
+
+    ASSERT_EQ(set1.size(), 6);
+    ASSERT_EQ(set2.size(), 5);
+}
+
+TEST(TestSet, setAlgebraInPlace) {
+    using CountedSet = treeset::Set<int, std::less<>, CountingAllocator<int>>;
+    CountedSet set1;
+    CountedSet set2;
+    for (int i = 0; i < 1000; i += 2) {
+        set1.insert(i);
+    }
+    for (int i = 0; i < 1000; i += 3) {
+        set2.insert(i);
+    }
+
+    allocations = 0;
+    set1.union_with(std::move(set2));
+    ASSERT_EQ(allocations, 0);
+    ASSERT_TRUE(set2.empty());
+    ASSERT_EQ(set1.size(), 667);
+    ASSERT_EQ(*set1.begin(), 0);
+    ASSERT_EQ(*set1.max(), 999);
+
+    CountedSet odd;
+    for (int i = 1; i < 1000; i += 2) {
+        odd.insert(i);
+    }
+    set1.difference_with(odd);
+    ASSERT_EQ(set1.size(), 500);
+    ASSERT_FALSE(set1.contains(3));
+    ASSERT_TRUE(set1.contains(4));
+
+    set1.intersect_with(std::move(odd));
+    ASSERT_TRUE(set1.empty());
+
+    set1.insert(1);
+    set1.symmetric_difference_with(CountedSet{1, 2});
+    ASSERT_EQ(set1.size(), 1);
+    ASSERT_EQ(*set1.begin(), 2);
+}
+
+TEST(TestSet, batches) {
+    treeset::Set<int, std::less<>, std::allocator<int>, treeset::threaded>
+        set;
+    std::vector<int> keys{5, 1, 9, 1, 3};
+    ASSERT_EQ(set.insert_batch(keys), 4);
+    ASSERT_EQ(set.insert_batch(std::vector<int>{9, 2}), 1);
+    ASSERT_EQ(set.erase_batch(std::vector<int>{1, 4, 9}), 2);
+    ASSERT_EQ(std::vector<int>(set.begin(), set.end()),
+              (std::vector<int>{2, 3, 5}));
+
+    using Op = treeset::BatchOp<int>;
+    std::vector<Op> ops{
+        {Op::insert, 7}, {Op::erase, 3}, {Op::erase, 7},
+        {Op::insert, 3}, {Op::erase, 2}, {Op::insert, 7},
+    };
+    set.apply_batch(ops);
+    ASSERT_EQ(std::vector<int>(set.begin(), set.end()),
+              (std::vector<int>{3, 5, 7}));
+    ASSERT_EQ(*--set.end(), 7);
+
+    treeset::Set<int, std::less<>, std::allocator<int>,
+                 treeset::order_statistics>
+        counted;
+    std::vector<int> expected;
+    for (int round = 0; round < 20; round++) {
+        std::vector<Op> batch;
+        for (int i = 0; i < 500; i++) {
+            int key = (i * 7919 + round * 104729) % 3000;
+            batch.push_back(
+                {(key + round) % 3 == 0 ? Op::erase : Op::insert, key});
+        }
+        counted.apply_batch(batch);
+        for (const auto& op : batch) {
+            auto pos =
+                std::lower_bound(expected.begin(), expected.end(), op.key);
+            bool present = pos != expected.end() && *pos == op.key;
+            if (op.kind == Op::insert && !present) {
+                expected.insert(pos, op.key);
+            } else if (op.kind == Op::erase && present) {
+                expected.erase(pos);
+            }
+        }
+        ASSERT_EQ(counted.size(), expected.size());
+        ASSERT_TRUE(std::equal(
+            counted.begin(), counted.end(), expected.begin(), expected.end()));
+        auto middle = expected.size() / 2;
+        ASSERT_EQ(*counted.nth(middle), expected[middle]);
+    }
+}
+
+TEST(TestSet, nodeHandles) {
+    treeset::Set<std::string> active{"a", "b", "c"};
+    treeset::Set<std::string> expired;
+
+    auto handle = active.extract("b");
+    ASSERT_FALSE(handle.empty());
+    ASSERT_EQ(handle.value(), "b");
+    ASSERT_EQ(active.size(), 2);
+    handle.value() = "bb";
+    auto result = expired.insert(std::move(handle));
+    ASSERT_TRUE(result.inserted);
+    ASSERT_EQ(*result.position, "bb");
+    ASSERT_TRUE(result.node.empty());
+
+    ASSERT_TRUE(active.extract("zzz").empty());
+    result = expired.insert(active.extract(active.begin()));
+    ASSERT_EQ(*result.position, "a");
+    expired.insert("c");
+    result = expired.insert(active.extract("c"));
+    ASSERT_FALSE(result.inserted);
+    ASSERT_EQ(result.node.value(), "c");
+    ASSERT_TRUE(active.empty());
+    ASSERT_EQ(*expired.insert(expired.end(), std::move(result.node)), "c");
+
+    using CountedSet = treeset::Set<int, std::less<>, CountingAllocator<int>,
+                                    treeset::order_statistics>;
+    CountedSet set1;
+    CountedSet set2;
+    for (int i = 0; i < 1000; i += 2) {
+        set1.insert(i);
+        set2.insert(i + 1);
+    }
+    allocations = 0;
+    set1.merge(set2);
+    ASSERT_EQ(allocations, 0);
+    ASSERT_TRUE(set2.empty());
+    ASSERT_EQ(set1.size(), 1000);
+    ASSERT_EQ(*set1.nth(501), 501);
+
+    CountedSet set3{5, 1000, 1001, -1};
+    set1.merge(set3);
+    ASSERT_EQ(set1.size(), 1003);
+    ASSERT_EQ(std::vector<int>(set3.begin(), set3.end()),
+              (std::vector<int>{5}));
+    int expected = -1;
+    for (auto key : set1) {
+        ASSERT_EQ(key, expected++);
+    }
+    ASSERT_EQ(*set1.max(), 1001);
+}
+
+TEST(TestSet, eraseIterator) {
+    using CountedSet = treeset::Set<int, std::less<>, std::allocator<int>,
+                                    treeset::order_statistics
+                                        | treeset::threaded>;
+    std::mt19937 rng(11);
+    CountedSet set;
+    std::set<int> expected;
+    for (int i = 0; i < 2000; i++) {
+        int key = int(rng() % 5000);
+        set.insert(key);
+        expected.insert(key);
+    }
+    // ключи не переезжают между узлами: адреса оставшихся не меняются
+    std::map<int, const int*> addresses;
+    for (auto& key : set) {
+        addresses[key] = &key;
+    }
+    while (set.size() > 10) {
+        auto it = set.nth(rng() % set.size());
+        auto next = std::next(it);
+        auto key = *it;
+        ASSERT_EQ(set.erase(it), next);
+        expected.erase(key);
+        addresses.erase(key);
+    }
+    ASSERT_TRUE(
+        std::equal(set.begin(), set.end(), expected.begin(), expected.end()));
+    for (auto& key : set) {
+        ASSERT_EQ(addresses[key], &key);
+    }
+    ASSERT_EQ(*set.nth(3), *std::next(expected.begin(), 3));
+
+    // очередь с истечением: срезаем всё, что меньше порога
+    treeset::Set<int> queue;
+    for (int i = 0; i < 100; i++) {
+        queue.insert(i);
+    }
+    auto last = queue.lower_bound(40);
+    ASSERT_EQ(queue.erase(queue.begin(), last), last);
+    ASSERT_EQ(*queue.begin(), 40);
+    ASSERT_EQ(queue.size(), 60);
+    ASSERT_EQ(queue.erase(queue.begin(), queue.end()), queue.end());
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST(TestSet, priorityQueue) {
+    std::mt19937 rng(5);
+    treeset::Set<int, std::less<>, std::allocator<int>, treeset::threaded>
+        queue;
+    std::set<int> expected;
+    for (int step = 0; step < 20000; step++) {
+        if (rng() % 3 != 0 || expected.empty()) {
+            int key = int(rng() % 1000);
+            queue.insert(key);
+            expected.insert(key);
+        } else if (rng() % 2 == 0) {
+            ASSERT_EQ(queue.pop_front(), *expected.begin());
+            expected.erase(expected.begin());
+        } else {
+            ASSERT_EQ(queue.pop_back(), *expected.rbegin());
+            expected.erase(std::prev(expected.end()));
+        }
+        if (!expected.empty()) {
+            ASSERT_EQ(queue.peek_min(), *expected.begin());
+            ASSERT_EQ(queue.peek_max(), *expected.rbegin());
+        }
+    }
+    ASSERT_TRUE(std::equal(
+        queue.begin(), queue.end(), expected.begin(), expected.end()));
+
+    treeset::Set<std::string> tasks{"b", "a", "c"};
+    ASSERT_EQ(tasks.pop_front(), "a");
+    ASSERT_EQ(tasks.pop_back(), "c");
+    ASSERT_EQ(tasks.peek_min(), "b");
+    ASSERT_EQ(tasks.peek_max(), "b");
+    ASSERT_EQ(tasks.pop_back(), "b");
+    ASSERT_TRUE(tasks.empty());
+    ASSERT_EQ(tasks.begin(), tasks.end());
+}
+
+TEST(TestSet, copyShape) {
+    using CountedSet =
+        treeset::Set<std::string, std::less<>, CountingAllocator<std::string>,
+                     treeset::order_statistics | treeset::threaded>;
+    std::mt19937 rng(9);
+    CountedSet set;
+    for (int i = 0; i < 5000; i++) {
+        set.insert(std::to_string(rng() % 100000));
+    }
+    for (int i = 0; i < 1000; i++) {
+        set.erase(set.nth(rng() % set.size()));
+    }
+
+    allocations = 0;
+    CountedSet copy(set);
+    // все узлы копии выделены одним блоком
+    ASSERT_EQ(allocations, 2);
+    ASSERT_EQ(copy.size(), set.size());
+    ASSERT_TRUE(std::equal(copy.begin(), copy.end(), set.begin(), set.end()));
+    ASSERT_TRUE(std::equal(
+        std::make_reverse_iterator(copy.end()),
+        std::make_reverse_iterator(copy.begin()),
+        std::make_reverse_iterator(set.end())));
+    for (std::size_t k = 0; k < set.size(); k += 97) {
+        ASSERT_EQ(*copy.nth(k), *set.nth(k));
+        ASSERT_EQ(copy.rank(*set.nth(k)), k);
+    }
+    ASSERT_EQ(copy.peek_min(), set.peek_min());
+    ASSERT_EQ(copy.peek_max(), set.peek_max());
+
+    CountedSet assigned{"x", "y"};
+    assigned = copy;
+    copy.clear();
+    ASSERT_TRUE(copy.empty());
+    ASSERT_TRUE(
+        std::equal(assigned.begin(), assigned.end(), set.begin(), set.end()));
+    assigned.insert("!");
+    ASSERT_EQ(*assigned.begin(), "!");
+    ASSERT_EQ(assigned.size(), set.size() + 1);
+
+    CountedSet empty;
+    assigned = empty;
+    ASSERT_TRUE(assigned.empty());
+    ASSERT_EQ(assigned.begin(), assigned.end());
+}
+
+TEST(TestSet, parallelFromSorted) {
+    treeset::ThreadPool pool(3);
+    treeset::Parallel policy{16, &pool};
+    std::vector<int> keys;
+    for (int i = 0; i < 5000; i++) {
+        keys.push_back(i * 2);
+    }
+
+    auto set = treeset::OrderedSet<int>::parallel_from_sorted(
+        keys.begin(), keys.end(), policy);
+    ASSERT_EQ(set.size(), 5000);
+    ASSERT_EQ(*set.begin(), 0);
+    ASSERT_EQ(*set.max(), 9998);
+    ASSERT_EQ(*set.nth(1234), 2468);
+    ASSERT_EQ(std::distance(set.begin(), set.end()), 5000);
+
+    set.insert(1);
+    set.erase(0);
+    ASSERT_EQ(*set.begin(), 1);
+    ASSERT_EQ(set.rank(2468), 1234);
+}
+
+TEST(TestSet, parallelSetAlgebra) {
+    treeset::ThreadPool pool(3);
+    treeset::Parallel policy{32, &pool};
+    treeset::Set<int> set1;
+    treeset::OrderedSet<int> set2;
+    treeset::OrderedSet<int> set3;
+    for (int i = 0; i < 20000; i += 2) {
+        set1.insert(i);
+        set2.insert(i);
+    }
+    for (int i = 0; i < 20000; i += 3) {
+        set3.insert(i);
+    }
+
+    auto set4 = set1;
+    set1.parallel_union_with(treeset::Set<int>(set3.begin(), set3.end()));
+    set4.union_with(treeset::Set<int>(set3.begin(), set3.end()));
+    ASSERT_EQ(set1.size(), 13333);
+    ASSERT_TRUE(std::equal(set1.begin(), set1.end(), set4.begin()));
+
+    auto set5 = set2;
+    set2.parallel_intersect_with(set3, policy);
+    set5.intersect_with(set3);
+    ASSERT_EQ(set2.size(), 3334);
+    ASSERT_TRUE(std::equal(set2.begin(), set2.end(), set5.begin()));
+    ASSERT_EQ(*set2.nth(100), 600);
+
+    set3.parallel_union_with(std::move(set5), policy);
+    ASSERT_TRUE(set5.empty());
+    ASSERT_EQ(set3.size(), 6667);
+    set3.parallel_intersect_with(set2, policy);
+    ASSERT_EQ(set3.size(), 3334);
+    ASSERT_EQ(set3.rank(600), 100);
+}
+
+TEST(TestSet, parallelTraversal) {
+    treeset::ThreadPool pool(3);
+    treeset::Parallel policy{8, &pool};
+    treeset::Set<int> set;
+    for (int i = 1; i <= 1000; i++) {
+        set.insert(i);
+    }
+
+    std::atomic<long> sum = 0;
+    set.parallel_for_each([&sum](int key) { sum += key; }, policy);
+    ASSERT_EQ(sum, 500500);
+
+    auto total = set.parallel_reduce(
+        0L, std::plus<>(), [](int key) { return long(key); }, policy);
+    ASSERT_EQ(total, 500500);
+
+    // порядок свертки сохраняется
+    auto digits = set.parallel_reduce(
+        std::string(), std::plus<>(),
+        [](int key) { return std::to_string(key % 10); }, policy);
+    ASSERT_EQ(digits.size(), 1000);
+    ASSERT_EQ(digits.substr(0, 12), "123456789012");
+
+    treeset::Set<int> empty;
+    ASSERT_EQ(empty.parallel_reduce(7, std::plus<>(), [](int key) {
+        return key;
+    }), 7);
+}
+
 TEST(TestIterator, constructors) {
     treeset::Set<int> set{1, 2, 3, 4, 5};
 
@@ -409,6 +1279,31 @@ TEST(TestIterator, decrement) {
     ASSERT_FALSE(iter1 != iter2);
 }
 
+TEST(TestIterator, singlePointer) {
+    treeset::Set<int> set;
+    ASSERT_EQ(sizeof(set.begin()), sizeof(void*));
+    ASSERT_EQ(set.begin(), set.end());
+
+    auto end = set.end();
+    for (int i = 0; i < 100; i++) {
+        set.insert(i);
+        auto last = end;
+        ASSERT_EQ(*--last, i);
+    }
+    ASSERT_EQ(*set.max(), 99);
+
+    auto iter = set.find(50);
+    set.insert(1000);
+    ASSERT_EQ(*--iter, 49);
+    ASSERT_EQ(*++ ++iter, 51);
+    ASSERT_EQ(*--set.end(), 1000);
+    set.erase(1000);
+
+    treeset::OrderedSet<int> ordered(set.begin(), set.end());
+    ASSERT_EQ(ordered.end() - ordered.begin(), 100);
+    ASSERT_EQ(*(ordered.end() - 1), 99);
+}
+
 TEST(TestIterator, bidirIterator) {
     treeset::Set<int> set;
     for (int i = 0; i < 10; i++) {